@@ -0,0 +1,254 @@
+#ifndef lacpp_affinity_hpp
+#define lacpp_affinity_hpp lacpp_affinity_hpp
+
+/* thread placement for the benchmark
+ *
+ * The topology is read from sysfs, restricted to the cpus this process
+ * may run on (taskset, cgroups). A placement is the list of cpus the
+ * worker threads are pinned to, worker i runs on cpus[i % size]:
+ *   compact   fill a NUMA node before using the next one, the
+ *             hyperthreads of a core next to each other
+ *   scatter   round robin over the nodes, and in a node over the cores
+ *             before their second hyperthreads
+ *   0,2,4-7   an explicit list of cpus, in this order
+ * Memory of the list under test is placed by the thread that builds it:
+ *   local       it runs on the first cpu of the placement, so first-touch
+ *               puts the prefilled list on that cpu's node
+ *   interleave  pages are spread over all nodes of the placement,
+ *               set_mempolicy(MPOL_INTERLEAVE), inherited by the workers
+ * Without sysfs every allowed cpu is its own core on node 0.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <sched.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace affinity_detail {
+	struct cpu_info {
+		int cpu;
+		int node;
+		int package;
+		int core;
+		int sibling; // rank among the hyperthreads of its core
+	};
+
+	/* parse a sysfs/taskset style list such as 0,2,4-7 */
+	static inline bool parse_cpu_list(const std::string& s, std::vector<int>& cpus) {
+		std::istringstream in(s);
+		std::string part;
+		while(std::getline(in, part, ',')) {
+			std::istringstream ps(part);
+			int first;
+			int last;
+			char dash;
+			if(!(ps >> first) || first < 0) {
+				return false;
+			}
+			last = first;
+			if(ps >> dash && (dash != '-' || !(ps >> last) || last < first)) {
+				return false;
+			}
+			if(!(ps >> std::ws).eof()) {
+				return false;
+			}
+			for(int c = first; c <= last; c++) {
+				cpus.push_back(c);
+			}
+		}
+		return !cpus.empty();
+	}
+
+	static inline bool read_line(const std::string& path, std::string& line) {
+		std::ifstream f(path);
+		return static_cast<bool>(std::getline(f, line));
+	}
+
+	static inline int read_int(const std::string& path, int fallback) {
+		std::string line;
+		int v;
+		return read_line(path, line) && (std::istringstream(line) >> v) ? v : fallback;
+	}
+
+	/* the cpus this process may run on, sorted */
+	static inline std::vector<cpu_info> topology() {
+		cpu_set_t allowed;
+		CPU_ZERO(&allowed);
+		if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+			for(int c = 0; c < CPU_SETSIZE; c++) {
+				CPU_SET(c, &allowed);
+			}
+		}
+		std::vector<int> online;
+		std::string line;
+		if(!read_line("/sys/devices/system/cpu/online", line) || !parse_cpu_list(line, online)) {
+			online.clear();
+			for(int c = 0; c < CPU_SETSIZE; c++) {
+				if(CPU_ISSET(c, &allowed)) {
+					online.push_back(c);
+				}
+			}
+		}
+		std::vector<int> nodes;
+		if(!read_line("/sys/devices/system/node/online", line) || !parse_cpu_list(line, nodes)) {
+			nodes.clear();
+		}
+		std::vector<cpu_info> cpus;
+		for(int c : online) {
+			if(c >= CPU_SETSIZE || !CPU_ISSET(c, &allowed)) {
+				continue;
+			}
+			std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(c) + "/topology/";
+			cpus.push_back({c, 0, read_int(dir + "physical_package_id", 0), read_int(dir + "core_id", c), 0});
+		}
+		for(int n : nodes) {
+			std::vector<int> members;
+			if(read_line("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist", line) && parse_cpu_list(line, members)) {
+				for(auto& ci : cpus) {
+					if(std::find(members.begin(), members.end(), ci.cpu) != members.end()) {
+						ci.node = n;
+					}
+				}
+			}
+		}
+		/* cpus are listed in order, so earlier ones get the lower ranks */
+		for(std::size_t i = 0; i < cpus.size(); i++) {
+			for(std::size_t j = 0; j < i; j++) {
+				if(cpus[j].package == cpus[i].package && cpus[j].core == cpus[i].core) {
+					cpus[i].sibling++;
+				}
+			}
+		}
+		return cpus;
+	}
+
+	static inline const cpu_info* find(const std::vector<cpu_info>& topo, int cpu) {
+		for(auto& ci : topo) {
+			if(ci.cpu == cpu) {
+				return &ci;
+			}
+		}
+		return nullptr;
+	}
+
+	/* compress 0,1,2,3,5 into 0-3,5 */
+	static inline std::string format_list(const std::vector<int>& v) {
+		std::string s;
+		for(std::size_t i = 0; i < v.size(); ) {
+			std::size_t j = i;
+			while(j + 1 < v.size() && v[j + 1] == v[j] + 1) {
+				j++;
+			}
+			s += (s.empty() ? "" : ",") + std::to_string(v[i]);
+			if(j > i) {
+				s += "-" + std::to_string(v[j]);
+			}
+			i = j + 1;
+		}
+		return s;
+	}
+}
+
+/* cpus for policy compact, scatter or an explicit list, false if the
+ * policy is invalid or names a cpu this process may not run on
+ */
+static inline bool make_placement(const std::string& policy, std::vector<int>& cpus) {
+	using namespace affinity_detail;
+	std::vector<cpu_info> topo = topology();
+	cpus.clear();
+	if(policy == "compact") {
+		std::sort(topo.begin(), topo.end(), [](const cpu_info& a, const cpu_info& b) {
+			return a.node != b.node ? a.node < b.node
+				: a.package != b.package ? a.package < b.package
+				: a.core != b.core ? a.core < b.core
+				: a.sibling < b.sibling;
+		});
+		for(auto& ci : topo) {
+			cpus.push_back(ci.cpu);
+		}
+	} else if(policy == "scatter") {
+		std::sort(topo.begin(), topo.end(), [](const cpu_info& a, const cpu_info& b) {
+			return a.sibling != b.sibling ? a.sibling < b.sibling
+				: a.package != b.package ? a.package < b.package
+				: a.core != b.core ? a.core < b.core
+				: a.cpu < b.cpu;
+		});
+		/* take the next cpu of every node in turn */
+		std::vector<int> nodes;
+		for(auto& ci : topo) {
+			if(std::find(nodes.begin(), nodes.end(), ci.node) == nodes.end()) {
+				nodes.push_back(ci.node);
+			}
+		}
+		std::sort(nodes.begin(), nodes.end());
+		std::vector<bool> taken(topo.size(), false);
+		while(cpus.size() < topo.size()) {
+			for(int n : nodes) {
+				for(std::size_t i = 0; i < topo.size(); i++) {
+					if(!taken[i] && topo[i].node == n) {
+						taken[i] = true;
+						cpus.push_back(topo[i].cpu);
+						break;
+					}
+				}
+			}
+		}
+	} else {
+		if(!parse_cpu_list(policy, cpus)) {
+			return false;
+		}
+		for(int c : cpus) {
+			if(find(topo, c) == nullptr) {
+				return false;
+			}
+		}
+	}
+	return !cpus.empty();
+}
+
+/* the placement as it is used: cpus and the node of each of them */
+static inline std::string describe_placement(const std::vector<int>& cpus) {
+	using namespace affinity_detail;
+	std::vector<cpu_info> topo = topology();
+	std::vector<int> nodes;
+	for(int c : cpus) {
+		const cpu_info* ci = find(topo, c);
+		nodes.push_back(ci != nullptr ? ci->node : 0);
+	}
+	return u8"cpus " + format_list(cpus) + u8" nodes " + format_list(nodes);
+}
+
+/* pin the calling thread to cpu */
+static inline bool pin_thread(int cpu) {
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+/* interleave the calling thread's future allocations over the nodes of
+ * cpus; threads it creates afterwards inherit the policy
+ */
+static inline bool interleave_memory(const std::vector<int>& cpus) {
+	using namespace affinity_detail;
+	/* from <numaif.h>, which comes with libnuma */
+	static const int MPOL_INTERLEAVE_ = 3;
+	static const int BITS = 8 * sizeof(unsigned long);
+	std::vector<cpu_info> topo = topology();
+	std::vector<unsigned long> mask;
+	for(int c : cpus) {
+		const cpu_info* ci = find(topo, c);
+		int n = ci != nullptr ? ci->node : 0;
+		mask.resize(std::max(mask.size(), static_cast<std::size_t>(n / BITS + 1)), 0);
+		mask[n / BITS] |= 1UL << (n % BITS);
+	}
+	/* the kernel ignores the last of maxnode bits */
+	return syscall(SYS_set_mempolicy, MPOL_INTERLEAVE_, mask.data(), mask.size() * BITS + 1) == 0;
+}
+
+#endif // lacpp_affinity_hpp
@@ -0,0 +1,74 @@
+#ifndef lacpp_batch_hpp
+#define lacpp_batch_hpp lacpp_batch_hpp
+
+/* batched operations on any sorted list variant
+ *
+ * insert_batch(l, keys, n)         insert the n values in keys
+ * remove_batch(l, keys, n)         remove each of the n values in keys once
+ * count_batch(l, keys, n, counts)  counts[i] = l.count(keys[i])
+ *
+ * keys must be sorted ascending. Lists that provide these operations as
+ * members apply the whole batch in one pass over the list (one lock
+ * acquisition for the coarse-grained lists, where the seqlock list counts
+ * in one validated optimistic read, one hand-over-hand sweep for the
+ * fine-grained lists); for all other lists the batch falls back to one
+ * single operation per key.
+ */
+
+#include <cstddef>
+
+namespace batch_detail {
+	/* the int overloads are preferred and only exist if l has the member */
+	template<typename List, typename T>
+	auto insert_batch(List& l, const T* keys, std::size_t n, int) -> decltype(l.insert_batch(keys, n)) {
+		return l.insert_batch(keys, n);
+	}
+
+	template<typename List, typename T>
+	void insert_batch(List& l, const T* keys, std::size_t n, long) {
+		for(std::size_t i = 0; i < n; i++) {
+			l.insert(keys[i]);
+		}
+	}
+
+	template<typename List, typename T>
+	auto remove_batch(List& l, const T* keys, std::size_t n, int) -> decltype(l.remove_batch(keys, n)) {
+		return l.remove_batch(keys, n);
+	}
+
+	template<typename List, typename T>
+	void remove_batch(List& l, const T* keys, std::size_t n, long) {
+		for(std::size_t i = 0; i < n; i++) {
+			l.remove(keys[i]);
+		}
+	}
+
+	template<typename List, typename T>
+	auto count_batch(List& l, const T* keys, std::size_t n, std::size_t* counts, int) -> decltype(l.count_batch(keys, n, counts)) {
+		return l.count_batch(keys, n, counts);
+	}
+
+	template<typename List, typename T>
+	void count_batch(List& l, const T* keys, std::size_t n, std::size_t* counts, long) {
+		for(std::size_t i = 0; i < n; i++) {
+			counts[i] = l.count(keys[i]);
+		}
+	}
+}
+
+template<typename List, typename T>
+void insert_batch(List& l, const T* keys, std::size_t n) {
+	batch_detail::insert_batch(l, keys, n, 0);
+}
+
+template<typename List, typename T>
+void remove_batch(List& l, const T* keys, std::size_t n) {
+	batch_detail::remove_batch(l, keys, n, 0);
+}
+
+template<typename List, typename T>
+void count_batch(List& l, const T* keys, std::size_t n, std::size_t* counts) {
+	batch_detail::count_batch(l, keys, n, counts, 0);
+}
+
+#endif // lacpp_batch_hpp
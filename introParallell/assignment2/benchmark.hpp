@@ -5,78 +5,411 @@
  * please report bugs or suggest improvements to david.klaftenegger@it.uu.se
  */
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
 #include <random>
+#include <sstream>
+#include <string>
 #include <thread>
 #include <vector>
 
-enum class worker_status {wait, work, finish};
+#include "affinity.hpp"
+#include "lock_stats.hpp"
+#include "perf_counters.hpp"
+
+enum class worker_status {wait, warmup, work, finish};
+
+enum class output_format {text, csv, json};
 
 static const int RANDOM_VALUE_RANGE_MIN = 0;
-static const int RANDOM_VALUE_RANGE_MAX = 65536;
+static const int RANDOM_VALUE_RANGE_MAX = 1 << 24;
+
+/* measured time of every benchmark() run, and the time the workers run
+ * before that without being measured; can be changed by the caller
+ */
+static double BENCHMARK_SECONDS = 5.0;
+static double WARMUP_SECONDS = 0.0;
+/* trials per benchmark() call, each with fresh workers on the same data */
+static int BENCHMARK_REPETITIONS = 1;
+/* time every LATENCY_SAMPLE_EVERY-th operation of a worker, 0 for none */
+static long LATENCY_SAMPLE_EVERY = 0;
+/* text keeps the one line per run format, csv and json add all statistics */
+static output_format BENCHMARK_OUTPUT = output_format::text;
+/* worker i is pinned to BENCHMARK_CPUS[i % size], see affinity.hpp;
+ * empty leaves the placement to the scheduler
+ */
+static std::vector<int> BENCHMARK_CPUS;
+/* time spent once measuring the cost of an empty operation in the worker
+ * loop, 0 for none; the results are then also given without that cost
+ */
+static double BASELINE_SECONDS = 0.0;
+/* operations between two looks at the worker status */
+static const int STATUS_CHECK_EVERY = 64;
+
+/* xorshift64* keys: a few cycles per key, where mt19937 with
+ * uniform_int_distribution costs about as much as a short list operation
+ */
+class key_stream {
+	std::uint64_t state;
+
+	public:
+		explicit key_stream(std::uint64_t seed) : state(seed * 0x9e3779b97f4a7c15ULL | 1) {}
+
+		/* uniform in [RANDOM_VALUE_RANGE_MIN, RANDOM_VALUE_RANGE_MAX] */
+		int next() {
+			state ^= state >> 12;
+			state ^= state << 25;
+			state ^= state >> 27;
+			std::uint64_t r = (state * 0x2545f4914f6cdd1dULL) >> 32;
+			/* scale the upper 32 bits instead of taking a modulo */
+			return RANDOM_VALUE_RANGE_MIN + static_cast<int>((r * (RANDOM_VALUE_RANGE_MAX - RANDOM_VALUE_RANGE_MIN + 1ULL)) >> 32);
+		}
+};
+
+/* what one worker measured */
+struct worker_result {
+	double ops_per_sec = 0.0;               // in thousands
+	long operations = 0;
+	std::vector<std::uint64_t> latencies;   // sampled, in ns
+	std::vector<double> counters;           // PERF_EVENTS, NaN if unavailable
+};
 
 /* template is used to allow functions/functors of any signature */
 template<typename Function>
-void worker(unsigned int random_seed, double& ops_per_sec, std::atomic<worker_status>* status, Function fun) {
+void worker(unsigned int random_seed, worker_result& result, std::atomic<worker_status>* status, Function fun) {
 	/* set up random number generator */
-	std::mt19937 engine(random_seed);
-	std::uniform_int_distribution<int> uniform_dist(RANDOM_VALUE_RANGE_MIN, RANDOM_VALUE_RANGE_MAX);
+	key_stream keys(random_seed);
+	/* opened early, that takes a few system calls */
+	perf_counters counters(PERF_EVENTS);
 	/* for time measurements */
 	typedef std::chrono::high_resolution_clock clock;
 	/* wait for everyone to be allowed to start */
-	while(*status == worker_status::wait);
+	while(status->load(std::memory_order_acquire) == worker_status::wait);
+	/* warm caches, allocator pools and the list itself, not measured */
+	while(status->load(std::memory_order_relaxed) == worker_status::warmup) {
+		for(int i = 0; i < STATUS_CHECK_EVERY; i++) {
+			fun(keys.next());
+		}
+	}
+	lock_stats_reset_thread();
+	counters.start();
 	std::chrono::time_point<clock> start_time = clock::now();
 	long items = 0;
-	while(*status == worker_status::work) {
-		auto random = uniform_dist(engine);
-		/* do specified work */
-		fun(random);
-		items++;
+	long next_sample = LATENCY_SAMPLE_EVERY;
+	/* seeing the end a few operations late only adds counted operations,
+	 * the time is taken after them
+	 */
+	while(status->load(std::memory_order_relaxed) == worker_status::work) {
+		for(int i = 0; i < STATUS_CHECK_EVERY; i++) {
+			auto random = keys.next();
+			if(items == next_sample - 1) {
+				/* do specified work, timed */
+				std::chrono::time_point<clock> op_start = clock::now();
+				fun(random);
+				result.latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - op_start).count());
+				next_sample += LATENCY_SAMPLE_EVERY;
+			} else {
+				/* do specified work */
+				fun(random);
+			}
+			items++;
+		}
 	}
 	std::chrono::time_point<clock> end_time = clock::now();
+	counters.stop();
 	double time = std::chrono::duration<double, std::ratio<1, 1000>>(end_time - start_time).count();
-	ops_per_sec = items / time;
-	std::this_thread::sleep_for(std::chrono::seconds(1));	
+	result.ops_per_sec = items / time;
+	result.operations = items;
+	result.counters = counters.read();
+	std::this_thread::sleep_for(std::chrono::seconds(1));
 	return;
 }
 
+/* summary of all trials of one benchmark() call, throughput in
+ * thousands of operations per second
+ */
+struct benchmark_result {
+	std::vector<double> trials;      // total of every trial
+	std::vector<double> per_thread;  // mean of every thread over the trials
+	double mean = 0.0;
+	double stddev = 0.0;
+	double ci95 = 0.0;               // half-width of the 95% confidence interval
+	double thread_min = 0.0;
+	double thread_max = 0.0;
+	double fairness = 1.0;           // Jain's index: 1 if all threads did equally well
+	std::size_t samples = 0;         // latency samples, percentiles in ns
+	std::uint64_t p50 = 0;
+	std::uint64_t p99 = 0;
+	std::uint64_t p999 = 0;
+	double baseline_ns = 0.0;        // cost of the worker loop per operation
+	double corrected = 0.0;          // mean without that cost
+	std::vector<double> per_op;      // PERF_EVENTS per operation, NaN if unavailable
+};
 
-template<typename Function>
-void benchmark(int threadcnt, std::string identifier, Function fun) {
-	/* initialize worker status */
-	std::atomic<worker_status> status;
-	status = worker_status::wait;
-
-	/* spawn workers */
-	std::vector<double> ops_per_second(threadcnt);
-	std::vector<std::thread*> workers;
-	std::random_device rd;
-	for(int i = 0; i < threadcnt; i++) {
-		auto seed = rd();
-		auto& result = ops_per_second[i];
-		auto w = new std::thread([seed, &result, &status, fun]() { worker(seed, result, &status, fun); });
-		workers.push_back(w);
-	};
+namespace benchmark_detail {
+	/* two-sided 95% quantile of Student's t distribution */
+	static inline double t95(int df) {
+		static const double table[30] = {
+			12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+			2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+			2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+		return df <= 30 ? table[df - 1] : 1.960;
+	}
 
-	/* start work for 5s */
-	status = worker_status::work;
-	std::this_thread::sleep_for(std::chrono::seconds(5));
-	status = worker_status::finish;
+	/* throughput of a thread without baseline_ns per operation; the
+	 * baseline is measured by one thread alone, so with more threads than
+	 * cpus this removes less than the loop really cost
+	 */
+	static inline double without_baseline(double ops_per_ms, double baseline_ns) {
+		double ms_per_op = 1.0 / ops_per_ms - baseline_ns * 1e-6;
+		return ops_per_ms > 0.0 && ms_per_op > 0.0 ? 1.0 / ms_per_op : ops_per_ms;
+	}
 
-	/* make sure all workers terminated */
-	for(auto& w : workers) {
-		w->join();
-		delete w;
+	static inline benchmark_result summarize(const std::vector<std::vector<worker_result>>& trials, double baseline_ns) {
+		benchmark_result r;
+		r.baseline_ns = baseline_ns;
+		std::size_t threads = trials.front().size();
+		r.per_thread.assign(threads, 0.0);
+		std::vector<std::uint64_t> latencies;
+		/* counters add up over the threads that could open them */
+		std::vector<double> counts(PERF_EVENTS.size(), 0.0);
+		std::vector<double> operations(PERF_EVENTS.size(), 0.0);
+		for(auto& trial : trials) {
+			double sum = 0.0;
+			for(std::size_t t = 0; t < threads; t++) {
+				const worker_result& w = trial[t];
+				sum += w.ops_per_sec;
+				r.per_thread[t] += w.ops_per_sec / trials.size();
+				r.corrected += without_baseline(w.ops_per_sec, baseline_ns) / trials.size();
+				latencies.insert(latencies.end(), w.latencies.begin(), w.latencies.end());
+				for(std::size_t e = 0; e < w.counters.size(); e++) {
+					if(!std::isnan(w.counters[e])) {
+						counts[e] += w.counters[e];
+						operations[e] += w.operations;
+					}
+				}
+			}
+			r.trials.push_back(sum);
+			r.mean += sum / trials.size();
+		}
+		if(r.trials.size() > 1) {
+			double sq = 0.0;
+			for(double v : r.trials) {
+				sq += (v - r.mean) * (v - r.mean);
+			}
+			int df = static_cast<int>(r.trials.size()) - 1;
+			r.stddev = std::sqrt(sq / df);
+			r.ci95 = t95(df) * r.stddev / std::sqrt(static_cast<double>(r.trials.size()));
+		}
+		double sum = 0.0;
+		double sq = 0.0;
+		r.thread_min = r.per_thread.front();
+		r.thread_max = r.per_thread.front();
+		for(double v : r.per_thread) {
+			sum += v;
+			sq += v * v;
+			r.thread_min = std::min(r.thread_min, v);
+			r.thread_max = std::max(r.thread_max, v);
+		}
+		r.fairness = sq > 0.0 ? sum * sum / (threads * sq) : 1.0;
+		for(std::size_t e = 0; e < PERF_EVENTS.size(); e++) {
+			r.per_op.push_back(operations[e] > 0.0 ? counts[e] / operations[e] : std::nan(""));
+		}
+		r.samples = latencies.size();
+		if(!latencies.empty()) {
+			auto percentile = [&latencies](double p) {
+				std::size_t k = static_cast<std::size_t>(p * (latencies.size() - 1));
+				std::nth_element(latencies.begin(), latencies.begin() + k, latencies.end());
+				return latencies[k];
+			};
+			r.p50 = percentile(0.5);
+			r.p99 = percentile(0.99);
+			r.p999 = percentile(0.999);
+		}
+		return r;
 	}
-	workers.clear();
 
-	/* compute sum of partial results */
-	double result = 0.0;
-	for(auto& v : ops_per_second) {
-		result += v;
+	static inline std::string csv_quote(const std::string& s) {
+		std::string q = "\"";
+		for(char c : s) {
+			q += c == '"' ? std::string("\"\"") : std::string(1, c);
+		}
+		return q + "\"";
 	}
-	std::cout << identifier << u8" / threads: " << threadcnt << u8" - thousands of operations per second: " << std::fixed << result << "\n";
+
+	static inline std::string json_quote(const std::string& s) {
+		std::string q = "\"";
+		for(char c : s) {
+			if(c == '"' || c == '\\') {
+				q += '\\';
+			}
+			q += c;
+		}
+		return q + "\"";
+	}
+
+	static inline std::string json_array(const std::vector<double>& v) {
+		std::ostringstream out;
+		out << std::fixed << "[";
+		for(std::size_t i = 0; i < v.size(); i++) {
+			out << (i == 0 ? "" : ",") << v[i];
+		}
+		out << "]";
+		return out.str();
+	}
+
+	static inline void report(const std::string& identifier, int threadcnt, const benchmark_result& r) {
+		if(BENCHMARK_OUTPUT == output_format::text) {
+			std::cout << identifier << u8" / threads: " << threadcnt << u8" - thousands of operations per second: " << std::fixed << r.mean << "\n";
+			if(r.trials.size() > 1 || r.samples > 0 || r.baseline_ns > 0.0) {
+				std::cout << identifier << u8" / threads: " << threadcnt
+					<< u8" - trials: " << r.trials.size()
+					<< u8", stddev: " << r.stddev
+					<< u8", 95% ci: +-" << r.ci95
+					<< u8", thread min/max: " << r.thread_min << u8"/" << r.thread_max
+					<< u8", fairness: " << r.fairness;
+				if(r.samples > 0) {
+					std::cout << u8", latency ns p50/p99/p999: " << r.p50 << u8"/" << r.p99 << u8"/" << r.p999;
+				}
+				if(r.baseline_ns > 0.0) {
+					std::cout << u8", empty op ns: " << r.baseline_ns << u8", without it: " << r.corrected;
+				}
+				std::cout << "\n";
+			}
+			if(!PERF_EVENTS.empty()) {
+				std::cout << identifier << u8" / threads: " << threadcnt << u8" - per operation:";
+				for(std::size_t e = 0; e < PERF_EVENTS.size(); e++) {
+					std::cout << (e == 0 ? u8" " : u8", ") << PERF_EVENTS[e].name << u8" ";
+					if(std::isnan(r.per_op[e])) {
+						std::cout << u8"n/a";
+					} else {
+						std::cout << r.per_op[e];
+					}
+				}
+				std::cout << "\n";
+			}
+		} else if(BENCHMARK_OUTPUT == output_format::csv) {
+			static bool header = false;
+			if(!header) {
+				std::cout << u8"identifier,threads,trials,mean,stddev,ci95,thread_min,thread_max,fairness,latency_samples,p50_ns,p99_ns,p999_ns,baseline_ns,corrected";
+				for(auto& e : PERF_EVENTS) {
+					std::cout << "," << csv_quote(e.name + u8" per op");
+				}
+				std::cout << "\n";
+				header = true;
+			}
+			std::cout << csv_quote(identifier) << "," << threadcnt << "," << r.trials.size() << "," << std::fixed
+				<< r.mean << "," << r.stddev << "," << r.ci95 << "," << r.thread_min << "," << r.thread_max << ","
+				<< r.fairness << "," << r.samples << "," << r.p50 << "," << r.p99 << "," << r.p999 << ","
+				<< r.baseline_ns << "," << r.corrected;
+			for(double v : r.per_op) {
+				/* empty if unavailable */
+				std::cout << ",";
+				if(!std::isnan(v)) {
+					std::cout << v;
+				}
+			}
+			std::cout << "\n";
+		} else {
+			/* one object per line */
+			std::cout << u8"{\"identifier\":" << json_quote(identifier) << u8",\"threads\":" << threadcnt << std::fixed
+				<< u8",\"mean\":" << r.mean << u8",\"stddev\":" << r.stddev << u8",\"ci95\":" << r.ci95
+				<< u8",\"trials\":" << json_array(r.trials) << u8",\"per_thread\":" << json_array(r.per_thread)
+				<< u8",\"fairness\":" << r.fairness << u8",\"latency_samples\":" << r.samples
+				<< u8",\"p50_ns\":" << r.p50 << u8",\"p99_ns\":" << r.p99 << u8",\"p999_ns\":" << r.p999
+				<< u8",\"baseline_ns\":" << r.baseline_ns << u8",\"corrected\":" << r.corrected << u8",\"per_op\":{";
+			for(std::size_t e = 0; e < PERF_EVENTS.size(); e++) {
+				std::cout << (e == 0 ? u8"" : u8",") << json_quote(PERF_EVENTS[e].name) << u8":";
+				if(std::isnan(r.per_op[e])) {
+					std::cout << u8"null";
+				} else {
+					std::cout << r.per_op[e];
+				}
+			}
+			std::cout << u8"}}\n";
+		}
+	}
+}
+
+namespace benchmark_detail {
+	/* run threadcnt workers once */
+	template<typename Function>
+	static std::vector<worker_result> run_trial(int threadcnt, double warmup, double seconds, Function fun) {
+		/* initialize worker status */
+		std::atomic<worker_status> status;
+		status = worker_status::wait;
+
+		/* spawn workers */
+		std::vector<worker_result> results(threadcnt);
+		std::vector<std::thread*> workers;
+		std::random_device rd;
+		for(int i = 0; i < threadcnt; i++) {
+			auto seed = rd();
+			auto& result = results[i];
+			int cpu = BENCHMARK_CPUS.empty() ? -1 : BENCHMARK_CPUS[i % BENCHMARK_CPUS.size()];
+			auto w = new std::thread([seed, cpu, &result, &status, fun]() {
+				if(cpu >= 0 && !pin_thread(cpu)) {
+					std::cerr << u8"Could not pin worker to cpu " << cpu << u8"\n";
+				}
+				worker(seed, result, &status, fun);
+			});
+			workers.push_back(w);
+		};
+
+		/* warm up, then start work for seconds */
+		status = worker_status::warmup;
+		std::this_thread::sleep_for(std::chrono::duration<double>(warmup));
+		status = worker_status::work;
+		std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+		status = worker_status::finish;
+
+		/* make sure all workers terminated */
+		for(auto& w : workers) {
+			w->join();
+			delete w;
+		}
+		return results;
+	}
+
+	/* stands in for a list operation, the key has to be computed */
+	struct empty_op {
+		void operator()(int key) const {
+			asm volatile("" : : "r"(key));
+		}
+	};
+
+	/* ns per operation of the worker loop itself, measured once */
+	static inline double baseline_ns() {
+		static double ns = -1.0;
+		if(ns < 0.0) {
+			double ops = run_trial(1, 0.0, BASELINE_SECONDS, empty_op())[0].ops_per_sec;
+			ns = ops > 0.0 ? 1e6 / ops : 0.0;
+		}
+		return ns;
+	}
+}
+
+template<typename Function>
+benchmark_result benchmark(int threadcnt, std::string identifier, Function fun) {
+	double baseline = BASELINE_SECONDS > 0.0 ? benchmark_detail::baseline_ns() : 0.0;
+	/* count only the locking done by this run */
+	lock_stats_reset();
+
+	std::vector<std::vector<worker_result>> trials;
+	for(int trial = 0; trial < BENCHMARK_REPETITIONS; trial++) {
+		trials.push_back(benchmark_detail::run_trial(threadcnt, WARMUP_SECONDS, BENCHMARK_SECONDS, fun));
+	}
+
+	/* compute statistics of the partial results */
+	benchmark_result result = benchmark_detail::summarize(trials, baseline);
+	benchmark_detail::report(identifier, threadcnt, result);
+	/* keep machine-readable output parseable */
+	lock_stats_dump(BENCHMARK_OUTPUT == output_format::text ? std::cout : std::cerr, identifier);
+	return result;
 }
 
 #endif // lacpp_benchmark_hpp
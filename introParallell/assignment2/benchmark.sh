@@ -0,0 +1,35 @@
+#!/bin/bash
+
+# Runs every sorted_list variant built by the Makefile at 1-64 threads
+# and several key ranges (the list is prefilled with twice the range)
+# further options are passed on to every run, e.g.
+#   ./benchmark.sh -d 2 -w 1 -z 0.99 -m 10,10,80
+#   ./benchmark.sh -a compact -N local -o csv
+# (see benchmark_example.cpp for the list of options)
+
+OUTPUT_FILE="benchmark_results.txt"
+THREADS=("1" "2" "4" "8" "16" "32" "64")
+# also run at 2x and 4x oversubscription of this machine,
+# where the *_adaptive and *_adaptive_mcs lock builds should stay stable
+CORES=$(nproc)
+THREADS=($(printf "%s\n" "${THREADS[@]}" "$((2 * CORES))" "$((4 * CORES))" | sort -n -u))
+RANGES=("256" "2048" "16384")
+
+make all
+if [ $? -ne 0 ]; then
+    echo "Compilation failed. Exiting."
+    exit 1
+fi
+
+for prog in benchmark_*; do
+    [ -x "$prog" ] || continue
+    for range in "${RANGES[@]}"; do
+        for threads in "${THREADS[@]}"; do
+            echo "Running $prog with $threads threads and key range $range ..."
+            echo "Variant: $prog" >> $OUTPUT_FILE
+            ./$prog $threads $range "$@" >> $OUTPUT_FILE
+        done
+    done
+done
+
+echo "All runs completed. Results saved in $OUTPUT_FILE."
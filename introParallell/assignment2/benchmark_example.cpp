@@ -1,20 +1,90 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <random>
 #include <sstream>
 #include <string>
+#include <vector>
 
+#include "batch.hpp"
 #include "benchmark.hpp"
-#include "sorted_list.hpp"
+#include "linearizability.hpp"
+#include "range.hpp"
+
+/* the list variant under test is chosen at compile time, e.g.
+ * g++ -DLIST_HEADER='"lock_free_harris.hpp"' ...
+ * all variants define sorted_list<T>, so only one can be included
+ * -DLIST_NODE_POOL allocates the list nodes from node_pool.hpp
+ * -DLIST_NODE_PADDED/-DLIST_NODE_STRIPED pick a layout from node_layout.hpp
+ * -DLIST_LOCK=<lock> replaces the default lock by one from locks.hpp
+ */
+#ifndef LIST_HEADER
+#define LIST_HEADER "sorted_list.hpp"
+#endif
+#include LIST_HEADER
 
 static const int DATA_VALUE_RANGE_MIN = 0;
-static const int DATA_VALUE_RANGE_MAX = 256;
-static const int DATA_PREFILL = 512;
+/* key range and prefill can be changed from the command line,
+ * by default the prefill is twice the key range
+ */
+static int DATA_VALUE_RANGE_MAX = 256;
+static int DATA_PREFILL = 512;
+
+/* Zipfian keys: ZIPF_CDF[i] is the probability of the i + 1 most popular
+ * keys, ZIPF_KEYS[i] is the i-th most popular key; empty for uniform keys
+ * the popular keys are spread over the range, not all at the list's head
+ */
+static std::vector<double> ZIPF_CDF;
+static std::vector<int> ZIPF_KEYS;
+
+static void init_zipf(double theta) {
+	ZIPF_CDF.resize(DATA_VALUE_RANGE_MAX);
+	ZIPF_KEYS.resize(DATA_VALUE_RANGE_MAX);
+	double sum = 0.0;
+	for(int i = 0; i < DATA_VALUE_RANGE_MAX; i++) {
+		sum += 1.0 / std::pow(i + 1, theta);
+		ZIPF_CDF[i] = sum;
+		ZIPF_KEYS[i] = i;
+	}
+	for(auto& p : ZIPF_CDF) {
+		p /= sum;
+	}
+	std::mt19937 engine(42);
+	std::shuffle(ZIPF_KEYS.begin(), ZIPF_KEYS.end(), engine);
+}
+
+/* scramble the bits of x (murmur3 finalizer) */
+static inline std::uint32_t mix(std::uint32_t x) {
+	x ^= x >> 16;
+	x *= 0x85ebca6bu;
+	x ^= x >> 13;
+	x *= 0xc2b2ae35u;
+	x ^= x >> 16;
+	return x;
+}
+
+/* the key for random value x, uniform or Zipfian */
+static inline int key(unsigned int x) {
+	if(ZIPF_KEYS.empty()) {
+		return static_cast<int>(x % static_cast<unsigned int>(DATA_VALUE_RANGE_MAX));
+	}
+	double u = mix(x) / 4294967296.0;
+	std::size_t rank = std::upper_bound(ZIPF_CDF.begin(), ZIPF_CDF.end(), u) - ZIPF_CDF.begin();
+	return ZIPF_KEYS[rank < ZIPF_KEYS.size() ? rank : ZIPF_KEYS.size() - 1];
+}
+
+/* percentages of the custom mix from the command line */
+static int MIX_INSERT = 0;
+static int MIX_REMOVE = 0;
 
 template<typename List>
 void read(List& l, int random) {
 	/* read operations: 100% count */
-	l.count(random % DATA_VALUE_RANGE_MAX);
+	l.count(key(random));
 }
 
 template<typename List>
@@ -22,9 +92,9 @@ void update(List& l, int random) {
 	/* update operations: 50% insert, 50% remove */
 	auto choice = (random % (2*DATA_VALUE_RANGE_MAX))/DATA_VALUE_RANGE_MAX;
 	if(choice == 0) {
-		l.insert(random % DATA_VALUE_RANGE_MAX);
+		l.insert(key(random));
 	} else {
-		l.remove(random % DATA_VALUE_RANGE_MAX);
+		l.remove(key(random));
 	}
 }
 
@@ -33,55 +103,359 @@ void mixed(List& l, int random) {
 	/* mixed operations: 6.25% update, 93.75% count */
 	auto choice = (random % (32*DATA_VALUE_RANGE_MAX))/DATA_VALUE_RANGE_MAX;
 	if(choice == 0) {
-		l.insert(random % DATA_VALUE_RANGE_MAX);
+		l.insert(key(random));
 	} else if(choice == 1) {
-		l.remove(random % DATA_VALUE_RANGE_MAX);
+		l.remove(key(random));
+	} else {
+		l.count(key(random));
+	}
+}
+
+template<typename List>
+void custom(List& l, int random) {
+	/* custom operations: MIX_INSERT% insert, MIX_REMOVE% remove, rest count
+	 * the operation is taken from scrambled bits, so it does not depend
+	 * on the key
+	 */
+	int choice = static_cast<int>(mix(static_cast<std::uint32_t>(random)) % 100);
+	if(choice < MIX_INSERT) {
+		l.insert(key(random));
+	} else if(choice < MIX_INSERT + MIX_REMOVE) {
+		l.remove(key(random));
 	} else {
-		l.count(random % DATA_VALUE_RANGE_MAX);
+		l.count(key(random));
 	}
 }
 
+/* keys per batch operation */
+static const std::size_t BATCH_SIZE = 16;
+
+template<typename List>
+void batch(List& l, int random) {
+	/* batch operations: 25% insert, 25% remove, 50% count
+	 * the BATCH_SIZE keys are derived from random and sorted
+	 */
+	int keys[BATCH_SIZE];
+	unsigned int x = static_cast<unsigned int>(random);
+	for(std::size_t i = 0; i < BATCH_SIZE; i++) {
+		x = x * 1103515245u + 12345u;
+		keys[i] = key(x >> 8);
+	}
+	std::sort(keys, keys + BATCH_SIZE);
+	auto choice = (random % (4*DATA_VALUE_RANGE_MAX))/DATA_VALUE_RANGE_MAX;
+	if(choice == 0) {
+		insert_batch(l, keys, BATCH_SIZE);
+	} else if(choice == 1) {
+		remove_batch(l, keys, BATCH_SIZE);
+	} else {
+		std::size_t counts[BATCH_SIZE];
+		count_batch(l, keys, BATCH_SIZE, counts);
+	}
+}
+
+template<typename List>
+void scan(List& l, int random) {
+	/* scan-heavy operations: 25% insert, 25% remove, 50% range_count
+	 * over a sixteenth of the key range, see range.hpp
+	 */
+	auto choice = (random % (4*DATA_VALUE_RANGE_MAX))/DATA_VALUE_RANGE_MAX;
+	int lo = key(random);
+	if(choice == 0) {
+		l.insert(lo);
+	} else if(choice == 1) {
+		l.remove(lo);
+	} else {
+		range_count(l, lo, lo + std::max(1, DATA_VALUE_RANGE_MAX / 16) - 1);
+	}
+}
+
+static void usage(const char* prog) {
+	std::cerr << u8"Usage: " << prog << u8" <threads> [key range] [options]\n"
+		<< u8"  -d <seconds>     measured time of every workload (default 5)\n"
+		<< u8"  -w <seconds>     warm-up before measuring (default 0)\n"
+		<< u8"  -r <range>       key range (default 256)\n"
+		<< u8"  -p <elements>    prefill (default twice the key range)\n"
+		<< u8"  -m <i>,<r>,<c>   run only this mix of insert, remove and count\n"
+		<< u8"                   percentages, e.g. -m 10,10,80\n"
+		<< u8"  -z <theta>       Zipfian keys with skew theta (default uniform)\n"
+		<< u8"  -n <trials>      repetitions of every workload (default 1)\n"
+		<< u8"  -l <every>       time every n-th operation for latency\n"
+		<< u8"                   percentiles (default 0, off)\n"
+		<< u8"  -o <format>      output as text, csv or json (default text)\n"
+		<< u8"  -e <seconds>     measure the cost of an empty operation and\n"
+		<< u8"                   also report results without it (default 0, off)\n"
+		<< u8"  -c <events>      hardware counters per operation: default, or a\n"
+		<< u8"                   list of cycles, instructions, cache-misses,\n"
+		<< u8"                   branch-misses, l1d-misses, llc-misses,\n"
+		<< u8"                   context-switches, page-faults, rUUEE\n"
+		<< u8"  -s <rounds>      check the list and its range queries for\n"
+		<< u8"                   linearizability instead of benchmarking it,\n"
+		<< u8"                   on 16 keys unless -r is given\n"
+		<< u8"  -a <placement>   pin workers: compact, scatter or a cpu list\n"
+		<< u8"                   such as 0,2,4-7 (default unpinned)\n"
+		<< u8"  -N <policy>      memory of the list: local to the first cpu\n"
+		<< u8"                   of the placement, or interleave over its nodes\n";
+	std::exit(EXIT_FAILURE);
+}
+
+/* parse all of arg into v */
+template<typename V>
+static bool parse(const char* arg, V& v) {
+	std::istringstream ss(arg);
+	return (ss >> v) && ss.eof();
+}
+
 int main(int argc, char* argv[]) {
 	/* get number of threads from command line */
 	if(argc < 2) {
-		std::cerr << u8"Please specify number of worker threads: " << argv[0] << u8" <number>\n";
-		std::exit(EXIT_FAILURE);
+		std::cerr << u8"Please specify number of worker threads: " << argv[0] << u8" <number> [key range] [options]\n";
+		usage(argv[0]);
 	}
-	std::istringstream ss(argv[1]);
 	int threadcnt;
-	if (!(ss >> threadcnt)) {
+	if (!parse(argv[1], threadcnt) || threadcnt < 1) {
 		std::cerr << u8"Invalid number of threads '" << argv[1] << u8"'\n";
 		std::exit(EXIT_FAILURE);
 	}
+#ifdef lacpp_thread_ids_hpp
+	/* lists with one slot per thread, the main thread takes one as well */
+	if(threadcnt >= max_thread_ids()) {
+		std::cerr << u8"At most " << max_thread_ids() - 1 << u8" threads for " LIST_HEADER u8" on this machine\n";
+		std::exit(EXIT_FAILURE);
+	}
+#endif
+	/* options, see usage() */
+	const char* range_arg = nullptr;
+	const char* prefill_arg = nullptr;
+	const char* mix_arg = nullptr;
+	const char* placement_arg = nullptr;
+	std::string numa;
+	double theta = 0.0;
+	int stress_rounds = 0;
+	int arg = 2;
+	if(arg < argc && argv[arg][0] != '-') {
+		/* optional key range */
+		range_arg = argv[arg++];
+	}
+	for(; arg < argc; arg++) {
+		if(std::strlen(argv[arg]) != 2 || argv[arg][0] != '-' || arg + 1 == argc) {
+			usage(argv[0]);
+		}
+		const char* option = argv[arg++];
+		const char* value = argv[arg];
+		bool ok = true;
+		switch(option[1]) {
+			case 'd':
+				ok = parse(value, BENCHMARK_SECONDS) && BENCHMARK_SECONDS > 0.0;
+				break;
+			case 'w':
+				ok = parse(value, WARMUP_SECONDS) && WARMUP_SECONDS >= 0.0;
+				break;
+			case 'r':
+				range_arg = value;
+				break;
+			case 'p':
+				prefill_arg = value;
+				break;
+			case 'm':
+				mix_arg = value;
+				break;
+			case 'z':
+				ok = parse(value, theta) && theta > 0.0;
+				break;
+			case 'n':
+				ok = parse(value, BENCHMARK_REPETITIONS) && BENCHMARK_REPETITIONS >= 1;
+				break;
+			case 'l':
+				ok = parse(value, LATENCY_SAMPLE_EVERY) && LATENCY_SAMPLE_EVERY >= 0;
+				break;
+			case 'o':
+				if(std::strcmp(value, "text") == 0) {
+					BENCHMARK_OUTPUT = output_format::text;
+				} else if(std::strcmp(value, "csv") == 0) {
+					BENCHMARK_OUTPUT = output_format::csv;
+				} else if(std::strcmp(value, "json") == 0) {
+					BENCHMARK_OUTPUT = output_format::json;
+				} else {
+					ok = false;
+				}
+				break;
+			case 'e':
+				ok = parse(value, BASELINE_SECONDS) && BASELINE_SECONDS >= 0.0;
+				break;
+			case 's':
+				ok = parse(value, stress_rounds) && stress_rounds >= 1;
+				break;
+			case 'c':
+				ok = parse_perf_events(value, PERF_EVENTS);
+				break;
+			case 'a':
+				placement_arg = value;
+				ok = make_placement(value, BENCHMARK_CPUS);
+				break;
+			case 'N':
+				numa = value;
+				ok = numa == "local" || numa == "interleave";
+				break;
+			default:
+				usage(argv[0]);
+		}
+		if(!ok) {
+			std::cerr << u8"Invalid argument '" << value << u8"' for " << option << u8"\n";
+			std::exit(EXIT_FAILURE);
+		}
+	}
+	/* mixed() picks its operation from random % (32 * key range),
+	 * so that has to fit into the random values benchmark() hands out
+	 */
+	if(range_arg != nullptr) {
+		if(!parse(range_arg, DATA_VALUE_RANGE_MAX) || DATA_VALUE_RANGE_MAX < 1 || DATA_VALUE_RANGE_MAX > RANDOM_VALUE_RANGE_MAX / 32) {
+			std::cerr << u8"Invalid key range '" << range_arg << u8"'\n";
+			std::exit(EXIT_FAILURE);
+		}
+		DATA_PREFILL = 2 * DATA_VALUE_RANGE_MAX;
+	}
+	if(stress_rounds > 0 && range_arg == nullptr) {
+		/* few keys, so that operations on the same key overlap */
+		DATA_VALUE_RANGE_MAX = 16;
+	}
+	if(prefill_arg != nullptr && (!parse(prefill_arg, DATA_PREFILL) || DATA_PREFILL < 0)) {
+		std::cerr << u8"Invalid prefill '" << prefill_arg << u8"'\n";
+		std::exit(EXIT_FAILURE);
+	}
+	if(mix_arg != nullptr) {
+		std::string m(mix_arg);
+		std::replace(m.begin(), m.end(), ',', ' ');
+		std::istringstream ms(m);
+		int count_percent;
+		if(!(ms >> MIX_INSERT >> MIX_REMOVE >> count_percent) || !(ms >> std::ws).eof()
+				|| MIX_INSERT < 0 || MIX_REMOVE < 0 || count_percent < 0
+				|| MIX_INSERT + MIX_REMOVE + count_percent != 100) {
+			std::cerr << u8"Invalid mix '" << mix_arg << u8"', percentages must add up to 100\n";
+			std::exit(EXIT_FAILURE);
+		}
+	}
+	if(theta > 0.0) {
+		init_zipf(theta);
+	}
+	if(BENCHMARK_CPUS.size() > static_cast<std::size_t>(threadcnt)) {
+		/* only the cpus threadcnt workers use */
+		BENCHMARK_CPUS.resize(threadcnt);
+	}
+	if(!numa.empty() && placement_arg == nullptr) {
+		std::cerr << u8"-N needs a placement from -a\n";
+		std::exit(EXIT_FAILURE);
+	}
+	/* before any list is built, so the policy applies to all of them */
+	if(numa == "local" && !pin_thread(BENCHMARK_CPUS.front())) {
+		std::cerr << u8"Could not pin to cpu " << BENCHMARK_CPUS.front() << u8"\n";
+		std::exit(EXIT_FAILURE);
+	}
+	if(numa == "interleave" && !interleave_memory(BENCHMARK_CPUS)) {
+		std::cerr << u8"Could not interleave memory\n";
+		std::exit(EXIT_FAILURE);
+	}
+	std::string identifier = std::string(LIST_HEADER) + u8" range " + std::to_string(DATA_VALUE_RANGE_MAX);
+#ifdef LIST_NODE_POOL
+	identifier += u8" pool";
+#endif
+#if defined(LIST_NODE_PADDED)
+	identifier += u8" padded";
+#elif defined(LIST_NODE_STRIPED)
+	identifier += u8" striped";
+#endif
+#ifdef LIST_LOCK
+#define LIST_LOCK_NAME_(lock) #lock
+#define LIST_LOCK_NAME(lock) LIST_LOCK_NAME_(lock)
+	identifier += u8" lock " LIST_LOCK_NAME(LIST_LOCK);
+#endif
+	if(prefill_arg != nullptr) {
+		identifier += u8" prefill " + std::to_string(DATA_PREFILL);
+	}
+	if(theta > 0.0) {
+		std::ostringstream zs;
+		zs << u8" zipf " << theta;
+		identifier += zs.str();
+	}
+	if(placement_arg != nullptr) {
+		identifier += u8" pin " + std::string(placement_arg) + u8" " + describe_placement(BENCHMARK_CPUS);
+	}
+	if(!numa.empty()) {
+		identifier += u8" numa " + numa;
+	}
+	if(stress_rounds > 0) {
+		bool ok = stress<sorted_list<int>>(threadcnt, stress_rounds, DATA_VALUE_RANGE_MAX, BENCHMARK_CPUS, identifier, std::cout)
+			&& stress_ranges<sorted_list<int>>(threadcnt, stress_rounds, DATA_VALUE_RANGE_MAX, BENCHMARK_CPUS, identifier, std::cout);
+		return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
 	/* set up random number generator */
 	std::random_device rd;
 	std::mt19937 engine(rd());
 	std::uniform_int_distribution<int> uniform_dist(DATA_VALUE_RANGE_MIN, DATA_VALUE_RANGE_MAX);
 
+	if(mix_arg != nullptr) {
+		/* only the mix from the command line */
+		sorted_list<int> l1;
+		/* prefill list with DATA_PREFILL elements */
+		for(int i = 0; i < DATA_PREFILL; i++) {
+			l1.insert(uniform_dist(engine));
+		}
+		std::string name = u8" mix " + std::to_string(MIX_INSERT) + u8"/" + std::to_string(MIX_REMOVE) + u8"/" + std::to_string(100 - MIX_INSERT - MIX_REMOVE);
+		benchmark(threadcnt, identifier + name, [&l1](int random){
+			custom(l1, random);
+		});
+		return EXIT_SUCCESS;
+	}
+
 	/* example use of benchmarking */
 	{
 		sorted_list<int> l1;
-		/* prefill list with 1024 elements */
+		/* prefill list with DATA_PREFILL elements */
 		for(int i = 0; i < DATA_PREFILL; i++) {
 			l1.insert(uniform_dist(engine));
 		}
-		benchmark(threadcnt, u8"non-thread-safe read", [&l1](int random){
+		benchmark(threadcnt, identifier + u8" read", [&l1](int random){
 			read(l1, random);
 		});
-		benchmark(threadcnt, u8"non-thread-safe update", [&l1](int random){
+		benchmark(threadcnt, identifier + u8" update", [&l1](int random){
 			update(l1, random);
 		});
 	}
 	{
 		/* start with fresh list: update test left list in random size */
 		sorted_list<int> l1;
-		/* prefill list with 1024 elements */
+		/* prefill list with DATA_PREFILL elements */
 		for(int i = 0; i < DATA_PREFILL; i++) {
 			l1.insert(uniform_dist(engine));
 		}
-		benchmark(threadcnt, u8"non-thread-safe mixed", [&l1](int random){
+		benchmark(threadcnt, identifier + u8" mixed", [&l1](int random){
 			mixed(l1, random);
 		});
 	}
+	{
+		/* fresh list again, every operation is a batch of BATCH_SIZE keys */
+		sorted_list<int> l1;
+		/* prefill list with DATA_PREFILL elements */
+		for(int i = 0; i < DATA_PREFILL; i++) {
+			l1.insert(uniform_dist(engine));
+		}
+		benchmark(threadcnt, identifier + u8" batch", [&l1](int random){
+			batch(l1, random);
+		});
+	}
+	{
+		/* fresh list again, half of the operations are range scans */
+		sorted_list<int> l1;
+		/* prefill list with DATA_PREFILL elements */
+		for(int i = 0; i < DATA_PREFILL; i++) {
+			l1.insert(uniform_dist(engine));
+		}
+		/* lists without a range_count of their own count key by key,
+		 * which is cheaper and not comparable to an atomic scan
+		 */
+		std::string name = atomic_range_count<sorted_list<int>, int>() ? u8" scan" : u8" scan per-key";
+		benchmark(threadcnt, identifier + name, [&l1](int random){
+			scan(l1, random);
+		});
+	}
 	return EXIT_SUCCESS;
 }
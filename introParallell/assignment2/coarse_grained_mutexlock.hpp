@@ -6,6 +6,10 @@
  */
 
 #include <mutex>
+#include <vector>
+
+#include "locks.hpp"
+#include "node_pool.hpp"
 
 /* struct for list nodes */
 template<typename T>
@@ -15,10 +19,10 @@ struct node {
 };
 
 /* non-concurrent sorted singly-linked list */
-template<typename T>
+template<typename T, typename Lock = default_lock<std::mutex>, typename Alloc = default_allocator>
 class sorted_list {
 	node<T>* first = nullptr;
-    std::mutex lock;
+    Lock lock;
 
 	public:
 		/* default implementations:
@@ -32,10 +36,10 @@ class sorted_list {
 		 * which are explicitly listed due to the rule of five.
 		 */
 		sorted_list() = default;
-		sorted_list(const sorted_list<T>& other) = default;
-		sorted_list(sorted_list<T>&& other) = default;
-		sorted_list<T>& operator=(const sorted_list<T>& other) = default;
-		sorted_list<T>& operator=(sorted_list<T>&& other) = default;
+		sorted_list(const sorted_list<T, Lock, Alloc>& other) = default;
+		sorted_list(sorted_list<T, Lock, Alloc>&& other) = default;
+		sorted_list<T, Lock, Alloc>& operator=(const sorted_list<T, Lock, Alloc>& other) = default;
+		sorted_list<T, Lock, Alloc>& operator=(sorted_list<T, Lock, Alloc>&& other) = default;
 		~sorted_list() {
 			while(first != nullptr) {
 				remove(first->value);
@@ -55,7 +59,7 @@ class sorted_list {
 			}
 
 			/* construct new node */
-			node<T>* current = new node<T>();
+			node<T>* current = Alloc::template create<node<T>>();
 			current->value = v;
 
 			/* insert new node between pred and succ */
@@ -90,7 +94,7 @@ class sorted_list {
 			} else {
 				pred->next = current->next;
 			}
-			delete current;
+			Alloc::template destroy<node<T>>(current);
 
             lock.unlock();
 		}
@@ -114,6 +118,125 @@ class sorted_list {
 			lock.unlock();
 			return cnt;
 		}
+
+		/* number of elements v with lo <= v <= hi */
+		std::size_t range_count(T lo, T hi) {
+            lock.lock();
+
+			std::size_t cnt = 0;
+			/* first go to value lo */
+			node<T>* current = first;
+			while(current != nullptr && current->value < lo) {
+				current = current->next;
+			}
+			/* count elements up to hi */
+			while(current != nullptr && !(hi < current->value)) {
+				cnt++;
+				current = current->next;
+			}
+
+			lock.unlock();
+			return cnt;
+		}
+
+		/* all elements in ascending order */
+		std::vector<T> snapshot() {
+            lock.lock();
+
+			std::vector<T> values;
+			for(node<T>* current = first; current != nullptr; current = current->next) {
+				values.push_back(current->value);
+			}
+
+			lock.unlock();
+			return values;
+		}
+
+		/* insert the n values in keys, sorted ascending, in one pass */
+		void insert_batch(const T* keys, std::size_t n) {
+			lock.lock();
+
+			node<T>* pred = nullptr;
+			node<T>* succ = first;
+			for(std::size_t i = 0; i < n; i++) {
+				/* find position, continuing from the previous key */
+				while(succ != nullptr && succ->value < keys[i]) {
+					pred = succ;
+					succ = succ->next;
+				}
+
+				/* construct new node */
+				node<T>* current = Alloc::template create<node<T>>();
+				current->value = keys[i];
+
+				/* insert new node between pred and succ */
+				current->next = succ;
+				if(pred == nullptr) {
+					first = current;
+				} else {
+					pred->next = current;
+				}
+				pred = current;
+			}
+			lock.unlock();
+		}
+
+		/* remove the n values in keys, sorted ascending, in one pass */
+		void remove_batch(const T* keys, std::size_t n) {
+			lock.lock();
+
+			node<T>* pred = nullptr;
+			node<T>* current = first;
+			for(std::size_t i = 0; i < n; i++) {
+				/* find position, continuing from the previous key */
+				while(current != nullptr && current->value < keys[i]) {
+					pred = current;
+					current = current->next;
+				}
+				if(current == nullptr || current->value != keys[i]) {
+					/* keys[i] not found */
+					continue;
+				}
+				/* remove current */
+				node<T>* next = current->next;
+				if(pred == nullptr) {
+					first = next;
+				} else {
+					pred->next = next;
+				}
+				Alloc::template destroy<node<T>>(current);
+				current = next;
+			}
+			lock.unlock();
+		}
+
+		/* count elements for the n values in keys, sorted ascending,
+		 * in one pass; counts[i] is the count of keys[i]
+		 */
+		void count_batch(const T* keys, std::size_t n, std::size_t* counts) {
+			lock.lock();
+
+			node<T>* current = first;
+			for(std::size_t i = 0; i < n; i++) {
+				if(i > 0 && keys[i] == keys[i - 1]) {
+					/* the run of keys[i] is already behind us */
+					counts[i] = counts[i - 1];
+					continue;
+				}
+				/* go to value keys[i] */
+				while(current != nullptr && current->value < keys[i]) {
+					current = current->next;
+				}
+				/* count elements */
+				std::size_t cnt = 0;
+				while(current != nullptr && current->value == keys[i]) {
+					cnt++;
+					current = current->next;
+				}
+				counts[i] = cnt;
+			}
+			lock.unlock();
+		}
 };
 
 #endif // lacpp_sorted_list_mutexlock_coarse_hpp
\ No newline at end of file
@@ -0,0 +1,310 @@
+#ifndef lacpp_sorted_list_rwlock_coarse_hpp
+#define lacpp_sorted_list_rwlock_coarse_hpp lacpp_sorted_list_rwlock_coarse_hpp
+
+/* a sorted list implementation by David Klaftenegger, 2015
+ * please report bugs or suggest improvements to david.klaftenegger@it.uu.se
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "locks.hpp"
+#include "node_pool.hpp"
+
+/* reader-writer lock with distributed reader indicators
+ * every thread announces itself as reader in its own cache line, so
+ * readers on different cores never write to the same line; a writer
+ * takes the writer flag and then waits for all indicators to drain
+ */
+class RWLock {
+    static const int READER_SLOTS = 64;
+
+    struct alignas(64) ReaderSlot {
+        std::atomic<int> readers{0};
+    };
+
+    alignas(64) std::atomic<bool> writer{false};
+    ReaderSlot slots[READER_SLOTS];
+
+    /* threads are spread over the slots in the order they first read */
+    static int my_slot() {
+        static std::atomic<int> next_slot{0};
+        thread_local int slot = next_slot.fetch_add(1, std::memory_order_relaxed) % READER_SLOTS;
+        return slot;
+    }
+
+public:
+    void lock_shared() {
+        std::atomic<int>& readers = slots[my_slot()].readers;
+        while (true) {
+            readers.fetch_add(1, std::memory_order_seq_cst);
+            if (!writer.load(std::memory_order_seq_cst)) {
+                return;
+            }
+            /* a writer is active or waiting: back off until it is done */
+            readers.fetch_sub(1, std::memory_order_release);
+            while (writer.load(std::memory_order_relaxed)) {
+                cpu_relax();
+            }
+        }
+    }
+
+    void unlock_shared() {
+        slots[my_slot()].readers.fetch_sub(1, std::memory_order_release);
+    }
+
+    void lock() {
+        while (true) {
+            while (writer.load(std::memory_order_relaxed)) {
+                /* keep spinning until no other writer is active */
+                cpu_relax();
+            }
+            if (!writer.exchange(true, std::memory_order_seq_cst)) {
+                break;
+            }
+        }
+        for (auto& s : slots) {
+            while (s.readers.load(std::memory_order_seq_cst) != 0) {
+                /* wait for readers that got in before us */
+                cpu_relax();
+            }
+        }
+    }
+
+    void unlock() {
+        writer.store(false, std::memory_order_release);
+    }
+};
+
+/* struct for list nodes */
+template<typename T>
+struct node {
+	T value;
+	node<T>* next;
+};
+
+/* concurrent sorted singly-linked list
+ * count() takes the lock shared, updates take it exclusively
+ */
+template<typename T, typename Alloc = default_allocator>
+class sorted_list {
+	node<T>* first = nullptr;
+    profiled_lock<RWLock> lock;
+
+	public:
+		/* default implementations:
+		 * default constructor
+		 * copy constructor (note: shallow copy)
+		 * move constructor
+		 * copy assignment operator (note: shallow copy)
+		 * move assignment operator
+		 *
+		 * The first is required due to the others,
+		 * which are explicitly listed due to the rule of five.
+		 */
+		sorted_list() = default;
+		sorted_list(const sorted_list<T, Alloc>& other) = default;
+		sorted_list(sorted_list<T, Alloc>&& other) = default;
+		sorted_list<T, Alloc>& operator=(const sorted_list<T, Alloc>& other) = default;
+		sorted_list<T, Alloc>& operator=(sorted_list<T, Alloc>&& other) = default;
+		~sorted_list() {
+			while(first != nullptr) {
+				remove(first->value);
+			}
+		}
+
+		/* insert v into the list */
+		void insert(T v) {
+            lock.lock();
+
+			/* first find position */
+			node<T>* pred = nullptr;
+			node<T>* succ = first;
+			while(succ != nullptr && succ->value < v) {
+				pred = succ;
+				succ = succ->next;
+			}
+
+			/* construct new node */
+			node<T>* current = Alloc::template create<node<T>>();
+			current->value = v;
+
+			/* insert new node between pred and succ */
+			current->next = succ;
+			if(pred == nullptr) {
+				first = current;
+			} else {
+				pred->next = current;
+			}
+
+			lock.unlock();
+		}
+
+		void remove(T v) {
+            lock.lock();
+
+			/* first find position */
+			node<T>* pred = nullptr;
+			node<T>* current = first;
+			while(current != nullptr && current->value < v) {
+				pred = current;
+				current = current->next;
+			}
+			if(current == nullptr || current->value != v) {
+				/* v not found */
+                lock.unlock();
+				return;
+			}
+			/* remove current */
+			if(pred == nullptr) {
+				first = current->next;
+			} else {
+				pred->next = current->next;
+			}
+			Alloc::template destroy<node<T>>(current);
+
+            lock.unlock();
+		}
+
+		/* count elements with value v in the list */
+		std::size_t count(T v) {
+            lock.lock_shared();
+
+			std::size_t cnt = 0;
+			/* first go to value v */
+			node<T>* current = first;
+			while(current != nullptr && current->value < v) {
+				current = current->next;
+			}
+			/* count elements */
+			while(current != nullptr && current->value == v) {
+				cnt++;
+				current = current->next;
+			}
+
+			lock.unlock_shared();
+			return cnt;
+		}
+
+		/* number of elements v with lo <= v <= hi */
+		std::size_t range_count(T lo, T hi) {
+            lock.lock_shared();
+
+			std::size_t cnt = 0;
+			/* first go to value lo */
+			node<T>* current = first;
+			while(current != nullptr && current->value < lo) {
+				current = current->next;
+			}
+			/* count elements up to hi */
+			while(current != nullptr && !(hi < current->value)) {
+				cnt++;
+				current = current->next;
+			}
+
+			lock.unlock_shared();
+			return cnt;
+		}
+
+		/* all elements in ascending order */
+		std::vector<T> snapshot() {
+            lock.lock_shared();
+
+			std::vector<T> values;
+			for(node<T>* current = first; current != nullptr; current = current->next) {
+				values.push_back(current->value);
+			}
+
+			lock.unlock_shared();
+			return values;
+		}
+
+		/* insert the n values in keys, sorted ascending, in one pass */
+		void insert_batch(const T* keys, std::size_t n) {
+			lock.lock();
+
+			node<T>* pred = nullptr;
+			node<T>* succ = first;
+			for(std::size_t i = 0; i < n; i++) {
+				/* find position, continuing from the previous key */
+				while(succ != nullptr && succ->value < keys[i]) {
+					pred = succ;
+					succ = succ->next;
+				}
+
+				/* construct new node */
+				node<T>* current = Alloc::template create<node<T>>();
+				current->value = keys[i];
+
+				/* insert new node between pred and succ */
+				current->next = succ;
+				if(pred == nullptr) {
+					first = current;
+				} else {
+					pred->next = current;
+				}
+				pred = current;
+			}
+			lock.unlock();
+		}
+
+		/* remove the n values in keys, sorted ascending, in one pass */
+		void remove_batch(const T* keys, std::size_t n) {
+			lock.lock();
+
+			node<T>* pred = nullptr;
+			node<T>* current = first;
+			for(std::size_t i = 0; i < n; i++) {
+				/* find position, continuing from the previous key */
+				while(current != nullptr && current->value < keys[i]) {
+					pred = current;
+					current = current->next;
+				}
+				if(current == nullptr || current->value != keys[i]) {
+					/* keys[i] not found */
+					continue;
+				}
+				/* remove current */
+				node<T>* next = current->next;
+				if(pred == nullptr) {
+					first = next;
+				} else {
+					pred->next = next;
+				}
+				Alloc::template destroy<node<T>>(current);
+				current = next;
+			}
+			lock.unlock();
+		}
+
+		/* count elements for the n values in keys, sorted ascending,
+		 * in one pass; counts[i] is the count of keys[i]
+		 */
+		void count_batch(const T* keys, std::size_t n, std::size_t* counts) {
+			lock.lock_shared();
+
+			node<T>* current = first;
+			for(std::size_t i = 0; i < n; i++) {
+				if(i > 0 && keys[i] == keys[i - 1]) {
+					/* the run of keys[i] is already behind us */
+					counts[i] = counts[i - 1];
+					continue;
+				}
+				/* go to value keys[i] */
+				while(current != nullptr && current->value < keys[i]) {
+					current = current->next;
+				}
+				/* count elements */
+				std::size_t cnt = 0;
+				while(current != nullptr && current->value == keys[i]) {
+					cnt++;
+					current = current->next;
+				}
+				counts[i] = cnt;
+			}
+			lock.unlock_shared();
+		}
+};
+
+#endif // lacpp_sorted_list_rwlock_coarse_hpp
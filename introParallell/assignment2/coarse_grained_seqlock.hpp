@@ -0,0 +1,340 @@
+#ifndef lacpp_sorted_list_seqlock_coarse_hpp
+#define lacpp_sorted_list_seqlock_coarse_hpp lacpp_sorted_list_seqlock_coarse_hpp
+
+/* a seqlock protected sorted list based on the sorted list
+ * implementation by David Klaftenegger, 2015
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "locks.hpp"
+#include "node_pool.hpp"
+#include "reclamation.hpp"
+
+/* sequence lock
+ * writers exclude each other with a TATAS lock and make the sequence
+ * number odd while they modify the protected data; readers never write,
+ * they retry if the sequence number was odd or changed during their read
+ */
+class SeqLock {
+    std::atomic<bool> flag{false};
+    std::atomic<unsigned long> sequence{0};
+
+public:
+    void lock() {
+        while (true) {
+            while (flag.load(std::memory_order_relaxed)) {
+                /* keep spinning until the lock seems available */
+                cpu_relax();
+            }
+            if (!flag.exchange(true, std::memory_order_acquire)) {
+                break;
+            }
+        }
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void unlock() {
+        sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        flag.store(false, std::memory_order_release);
+    }
+
+    /* start an optimistic read, waits while a writer is active */
+    unsigned long read_begin() const {
+        unsigned long s;
+        while ((s = sequence.load(std::memory_order_acquire)) & 1) {
+            cpu_relax();
+        }
+        return s;
+    }
+
+    /* true if no writer was active since read_begin() returned s */
+    bool read_validate(unsigned long s) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return sequence.load(std::memory_order_relaxed) == s;
+    }
+};
+
+/* struct for list nodes
+ * next is atomic as readers follow it while a writer may change it
+ */
+template<typename T>
+struct node {
+	T value;
+	std::atomic<node<T>*> next{nullptr};
+};
+
+/* concurrent sorted singly-linked list
+ * updates are serialized by a seqlock, count() reads optimistically
+ * and falls back to the lock after READ_RETRIES failed attempts;
+ * readers may be standing on a removed node, Reclaim defers freeing it
+ */
+template<typename T, typename Reclaim = epoch_reclamation, typename Alloc = default_allocator>
+class sorted_list {
+	static_assert(!Reclaim::needs_validation, "optimistic readers do not protect their hops");
+	typedef typename Reclaim::guard guard;
+
+	static const int READ_RETRIES = 8;
+
+	std::atomic<node<T>*> first{nullptr};
+    profiled_lock<SeqLock> lock;
+
+	/* may run concurrently with a writer: the result is only used if validated */
+	std::size_t count_unsafe(T v) {
+		std::size_t cnt = 0;
+		/* first go to value v */
+		node<T>* current = first.load(std::memory_order_acquire);
+		while(current != nullptr && current->value < v) {
+			current = current->next.load(std::memory_order_acquire);
+		}
+		/* count elements */
+		while(current != nullptr && current->value == v) {
+			cnt++;
+			current = current->next.load(std::memory_order_acquire);
+		}
+		return cnt;
+	}
+
+	/* count the elements v with lo <= v <= hi, and add them to values
+	 * unless it is nullptr
+	 */
+	std::size_t range_unsafe(T lo, T hi, std::vector<T>* values) {
+		std::size_t cnt = 0;
+		/* first go to value lo */
+		node<T>* current = first.load(std::memory_order_acquire);
+		while(current != nullptr && current->value < lo) {
+			current = current->next.load(std::memory_order_acquire);
+		}
+		/* collect elements up to hi */
+		while(current != nullptr && !(hi < current->value)) {
+			cnt++;
+			(values != nullptr) ? values->push_back(current->value) : void();
+			current = current->next.load(std::memory_order_acquire);
+		}
+		return cnt;
+	}
+
+	/* counts of the n values in keys, sorted ascending, in one pass;
+	 * may run concurrently with a writer like count_unsafe()
+	 */
+	void count_batch_unsafe(const T* keys, std::size_t n, std::size_t* counts) {
+		node<T>* current = first.load(std::memory_order_acquire);
+		for(std::size_t i = 0; i < n; i++) {
+			if(i > 0 && keys[i] == keys[i - 1]) {
+				/* the run of keys[i] is already behind us */
+				counts[i] = counts[i - 1];
+				continue;
+			}
+			/* go to value keys[i] */
+			while(current != nullptr && current->value < keys[i]) {
+				current = current->next.load(std::memory_order_acquire);
+			}
+			/* count elements */
+			std::size_t cnt = 0;
+			while(current != nullptr && current->value == keys[i]) {
+				cnt++;
+				current = current->next.load(std::memory_order_acquire);
+			}
+			counts[i] = cnt;
+		}
+	}
+
+	/* range_unsafe() read like count() */
+	std::size_t range(T lo, T hi, std::vector<T>* values) {
+		guard g;
+		for(int i = 0; i < READ_RETRIES; i++) {
+			unsigned long s = lock.read_begin();
+			(values != nullptr) ? values->clear() : void();
+			std::size_t cnt = range_unsafe(lo, hi, values);
+			if(lock.read_validate(s)) {
+				return cnt;
+			}
+		}
+		/* too many concurrent updates: read under the lock */
+		lock.lock();
+		(values != nullptr) ? values->clear() : void();
+		std::size_t cnt = range_unsafe(lo, hi, values);
+		lock.unlock();
+		return cnt;
+	}
+
+	public:
+		/* default constructor only:
+		 * copying or moving a list would race with concurrent users
+		 */
+		sorted_list() = default;
+		sorted_list(const sorted_list<T, Reclaim, Alloc>& other) = delete;
+		sorted_list(sorted_list<T, Reclaim, Alloc>&& other) = delete;
+		sorted_list<T, Reclaim, Alloc>& operator=(const sorted_list<T, Reclaim, Alloc>& other) = delete;
+		sorted_list<T, Reclaim, Alloc>& operator=(sorted_list<T, Reclaim, Alloc>&& other) = delete;
+		~sorted_list() {
+			node<T>* current = first.load(std::memory_order_relaxed);
+			while(current != nullptr) {
+				node<T>* next = current->next.load(std::memory_order_relaxed);
+				Alloc::template destroy<node<T>>(current);
+				current = next;
+			}
+		}
+
+		/* insert v into the list */
+		void insert(T v) {
+			/* construct new node */
+			node<T>* current = Alloc::template create<node<T>>();
+			current->value = v;
+
+            lock.lock();
+
+			/* first find position */
+			std::atomic<node<T>*>* pred_next = &first;
+			node<T>* succ = first.load(std::memory_order_relaxed);
+			while(succ != nullptr && succ->value < v) {
+				pred_next = &succ->next;
+				succ = succ->next.load(std::memory_order_relaxed);
+			}
+
+			/* insert new node between pred and succ */
+			current->next.store(succ, std::memory_order_relaxed);
+			pred_next->store(current, std::memory_order_release);
+
+			lock.unlock();
+		}
+
+		void remove(T v) {
+            lock.lock();
+
+			/* first find position */
+			std::atomic<node<T>*>* pred_next = &first;
+			node<T>* current = first.load(std::memory_order_relaxed);
+			while(current != nullptr && current->value < v) {
+				pred_next = &current->next;
+				current = current->next.load(std::memory_order_relaxed);
+			}
+			if(current == nullptr || current->value != v) {
+				/* v not found */
+                lock.unlock();
+				return;
+			}
+			/* remove current */
+			pred_next->store(current->next.load(std::memory_order_relaxed), std::memory_order_release);
+
+            lock.unlock();
+			Reclaim::retire(current, &Alloc::template destroy<node<T>>);
+		}
+
+		/* count elements with value v in the list */
+		std::size_t count(T v) {
+			guard g;
+			for(int i = 0; i < READ_RETRIES; i++) {
+				unsigned long s = lock.read_begin();
+				std::size_t cnt = count_unsafe(v);
+				if(lock.read_validate(s)) {
+					return cnt;
+				}
+			}
+			/* too many concurrent updates: read under the lock */
+			lock.lock();
+			std::size_t cnt = count_unsafe(v);
+			lock.unlock();
+			return cnt;
+		}
+
+		/* insert the n values in keys, sorted ascending, in one pass
+		 * under one lock acquisition
+		 */
+		void insert_batch(const T* keys, std::size_t n) {
+            lock.lock();
+
+			std::atomic<node<T>*>* pred_next = &first;
+			node<T>* succ = first.load(std::memory_order_relaxed);
+			for(std::size_t i = 0; i < n; i++) {
+				/* find position, continuing from the previous key */
+				while(succ != nullptr && succ->value < keys[i]) {
+					pred_next = &succ->next;
+					succ = succ->next.load(std::memory_order_relaxed);
+				}
+
+				/* construct new node */
+				node<T>* current = Alloc::template create<node<T>>();
+				current->value = keys[i];
+
+				/* insert new node between pred and succ */
+				current->next.store(succ, std::memory_order_relaxed);
+				pred_next->store(current, std::memory_order_release);
+				pred_next = &current->next;
+			}
+
+			lock.unlock();
+		}
+
+		/* remove the n values in keys, sorted ascending, in one pass
+		 * under one lock acquisition
+		 */
+		void remove_batch(const T* keys, std::size_t n) {
+			/* retired after unlocking, like in remove() */
+			std::vector<node<T>*> removed;
+			removed.reserve(n);
+
+            lock.lock();
+
+			std::atomic<node<T>*>* pred_next = &first;
+			node<T>* current = first.load(std::memory_order_relaxed);
+			for(std::size_t i = 0; i < n; i++) {
+				/* find position, continuing from the previous key */
+				while(current != nullptr && current->value < keys[i]) {
+					pred_next = &current->next;
+					current = current->next.load(std::memory_order_relaxed);
+				}
+				if(current == nullptr || current->value != keys[i]) {
+					/* keys[i] not found */
+					continue;
+				}
+				/* remove current, readers on it still find their way on */
+				node<T>* next = current->next.load(std::memory_order_relaxed);
+				pred_next->store(next, std::memory_order_release);
+				removed.push_back(current);
+				current = next;
+			}
+
+            lock.unlock();
+			for(node<T>* r : removed) {
+				Reclaim::retire(r, &Alloc::template destroy<node<T>>);
+			}
+		}
+
+		/* count elements for the n values in keys, sorted ascending,
+		 * in one optimistic pass like count(); counts[i] is the count
+		 * of keys[i]
+		 */
+		void count_batch(const T* keys, std::size_t n, std::size_t* counts) {
+			guard g;
+			for(int i = 0; i < READ_RETRIES; i++) {
+				unsigned long s = lock.read_begin();
+				count_batch_unsafe(keys, n, counts);
+				if(lock.read_validate(s)) {
+					return;
+				}
+			}
+			/* too many concurrent updates: read under the lock */
+			lock.lock();
+			count_batch_unsafe(keys, n, counts);
+			lock.unlock();
+		}
+
+		/* number of elements v with lo <= v <= hi */
+		std::size_t range_count(T lo, T hi) {
+			return range(lo, hi, nullptr);
+		}
+
+		/* all elements in ascending order */
+		std::vector<T> snapshot() {
+			std::vector<T> values;
+			range(std::numeric_limits<T>::lowest(), std::numeric_limits<T>::max(), &values);
+			return values;
+		}
+};
+
+#endif // lacpp_sorted_list_seqlock_coarse_hpp
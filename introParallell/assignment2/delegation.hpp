@@ -0,0 +1,129 @@
+#ifndef lacpp_sorted_list_delegation_hpp
+#define lacpp_sorted_list_delegation_hpp lacpp_sorted_list_delegation_hpp
+
+/* a delegating wrapper (in the style of ffwd, Roghanchi, Eriksson, Basu)
+ * around the sorted list implementation by David Klaftenegger, 2015
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+#include "node_pool.hpp"
+#include "sequential_list.hpp"
+#include "thread_ids.hpp"
+
+/* sorted list owned by a dedicated server thread
+ * clients never touch the list: they write their operation into their own
+ * request line and spin on their own response line, which only the server
+ * writes, so every line is written by one thread and only read by one
+ * other; the list itself never leaves the server's cache
+ */
+template<typename T, typename Alloc = default_allocator>
+class sorted_list {
+	enum operation { INSERT, REMOVE, COUNT };
+	/* idle scans (or client spins) before yielding the processor */
+	static const int SPINS_BEFORE_YIELD = 1024;
+
+	/* a new request is posted by incrementing seq */
+	struct alignas(64) request {
+		std::atomic<unsigned int> seq{0};
+		int op;
+		T value;
+	};
+
+	/* seq is set to the request's seq once result is valid */
+	struct alignas(64) response {
+		std::atomic<unsigned int> seq{0};
+		std::size_t result;
+	};
+
+	thread_slots<request> requests;
+	thread_slots<response> responses;
+	/* only touched by the server thread */
+	sequential::sorted_list<T, Alloc> list;
+	thread_slots<unsigned int> served;
+	std::atomic<bool> stop{false};
+	std::thread server;
+
+	void serve() {
+		int idle = 0;
+		while(!stop.load(std::memory_order_relaxed)) {
+			bool found = false;
+			int limit = thread_id_limit();
+			for(int i = 0; i < limit; i++) {
+				unsigned int seq = requests[i].seq.load(std::memory_order_acquire);
+				if(seq == served[i]) {
+					continue;
+				}
+				const request& r = requests[i];
+				if(r.op == INSERT) {
+					list.insert(r.value);
+				} else if(r.op == REMOVE) {
+					list.remove(r.value);
+				} else {
+					responses[i].result = list.count(r.value);
+				}
+				served[i] = seq;
+				responses[i].seq.store(seq, std::memory_order_release);
+				found = true;
+			}
+			if(found) {
+				idle = 0;
+			} else if(++idle == SPINS_BEFORE_YIELD) {
+				idle = 0;
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	/* post op on v and wait for the server's response */
+	std::size_t execute(int op, T v) {
+		int id = current_thread_id();
+		request& r = requests[id];
+		/* only this thread writes r.seq, also if the id was used before */
+		unsigned int seq = r.seq.load(std::memory_order_relaxed) + 1;
+		r.op = op;
+		r.value = v;
+		r.seq.store(seq, std::memory_order_release);
+		int spins = 0;
+		while(responses[id].seq.load(std::memory_order_acquire) != seq) {
+			if(++spins == SPINS_BEFORE_YIELD) {
+				spins = 0;
+				std::this_thread::yield();
+			}
+		}
+		return responses[id].result;
+	}
+
+	public:
+		/* default constructor only, it starts the server thread:
+		 * copying or moving a list would race with concurrent users
+		 */
+		sorted_list() : server(&sorted_list<T, Alloc>::serve, this) {}
+		sorted_list(const sorted_list<T, Alloc>& other) = delete;
+		sorted_list(sorted_list<T, Alloc>&& other) = delete;
+		sorted_list<T, Alloc>& operator=(const sorted_list<T, Alloc>& other) = delete;
+		sorted_list<T, Alloc>& operator=(sorted_list<T, Alloc>&& other) = delete;
+		/* all clients must be done: the server only stops once */
+		~sorted_list() {
+			stop.store(true, std::memory_order_relaxed);
+			server.join();
+		}
+
+		/* insert v into the list */
+		void insert(T v) {
+			execute(INSERT, v);
+		}
+
+		void remove(T v) {
+			execute(REMOVE, v);
+		}
+
+		/* count elements with value v in the list */
+		std::size_t count(T v) {
+			return execute(COUNT, v);
+		}
+};
+
+#endif // lacpp_sorted_list_delegation_hpp
@@ -5,40 +5,81 @@
  * please report bugs or suggest improvements to david.klaftenegger@it.uu.se
  */
 
+#include <atomic>
+#include <cstddef>
+#include <limits>
 #include <mutex>
+#include <vector>
 
-/* struct for list nodes */
-template<typename T>
-struct node {
-	T value;
-	std::mutex lock;
-	node<T>* next;
-};
+#include "locks.hpp"
+#include "node_layout.hpp"
+#include "node_pool.hpp"
+#include "node_version.hpp"
+#include "reclamation.hpp"
 
-/* non-concurrent sorted singly-linked list */
-template<typename T>
+/* concurrent sorted singly-linked list using hand-over-hand locking
+ * head is a sentinel whose lock guards the link to the first element
+ * Layout decides where nodes keep their locks and which lock they use,
+ * see node_layout.hpp and locks.hpp
+ * range_count() and snapshot() see the list at one instant without
+ * taking locks, from the node versions; Reclaim defers freeing removed
+ * nodes that they may still traverse
+ */
+template<typename T, typename Layout = default_layout<default_lock<std::mutex>>, typename Reclaim = epoch_reclamation, typename Alloc = default_allocator>
 class sorted_list {
-	node<T>* first = nullptr;
+	static_assert(!Reclaim::needs_validation, "range scans do not protect their hops");
+	template<typename U>
+	using node = typename Layout::template node<U>;
+
+	typedef typename Reclaim::guard guard;
+	typedef node_versions<node<T>> versions;
+	typedef typename versions::seen_node seen_node;
+	node<T> head;
+
+	/* lock n, the successor of the locked pred, unless they share a lock */
+	static void lock_next(node<T>* pred, node<T>* n) {
+		(n != nullptr && !Layout::same_lock(pred, n)) ? Layout::lock(n) : void();
+	}
+
+	static void unlock_next(node<T>* pred, node<T>* n) {
+		(n != nullptr && !Layout::same_lock(pred, n)) ? Layout::unlock(n) : void();
+	}
+
+	/* release pred when moving on to n, unless n still needs its lock */
+	static void unlock_pred(node<T>* pred, node<T>* n) {
+		(n == nullptr || !Layout::same_lock(pred, n)) ? Layout::unlock(pred) : void();
+	}
+
+	/* the elements v with lo <= v <= hi at one instant, see node_version.hpp */
+	std::vector<seen_node> scan(T lo, T hi) {
+		return versions::scan(lo, hi, [this, lo]() {
+			/* the last node < lo, without locking */
+			node<T> *pred = &head;
+			node<T> *current = head.next.load(std::memory_order_acquire);
+			while (current != nullptr && current->value < lo) {
+				pred = current;
+				current = current->next.load(std::memory_order_acquire);
+			}
+			return pred;
+		});
+	}
 
 	public:
-		/* default implementations:
-		 * default constructor
-		 * copy constructor (note: shallow copy)
-		 * move constructor
-		 * copy assignment operator (note: shallow copy)
-		 * move assignment operator
-		 *
-		 * The first is required due to the others,
-		 * which are explicitly listed due to the rule of five.
+		/* default constructor only:
+		 * copying or moving a list would race with concurrent users
+		 * head() value-initializes the sentinel's value, see striped_layout
 		 */
-		sorted_list() = default;
-		sorted_list(const sorted_list<T>& other) = default;
-		sorted_list(sorted_list<T>&& other) = default;
-		sorted_list<T>& operator=(const sorted_list<T>& other) = default;
-		sorted_list<T>& operator=(sorted_list<T>&& other) = default;
+		sorted_list() : head() {}
+		sorted_list(const sorted_list<T, Layout, Reclaim, Alloc>& other) = delete;
+		sorted_list(sorted_list<T, Layout, Reclaim, Alloc>&& other) = delete;
+		sorted_list<T, Layout, Reclaim, Alloc>& operator=(const sorted_list<T, Layout, Reclaim, Alloc>& other) = delete;
+		sorted_list<T, Layout, Reclaim, Alloc>& operator=(sorted_list<T, Layout, Reclaim, Alloc>&& other) = delete;
 		~sorted_list() {
-			while(first != nullptr) {
-				remove(first->value);
+			node<T> *current = head.next.load(std::memory_order_relaxed);
+			while (current != nullptr) {
+				node<T> *next = current->next.load(std::memory_order_relaxed);
+				Alloc::template destroy<node<T>>(current);
+				current = next;
 			}
 		}
 
@@ -47,107 +88,237 @@ class sorted_list {
 			node<T> *pred;
 			node<T> *current;
 
-            /* list is empty */
-			if (first == nullptr) {
-				node<T> *newNode(new node<T>());
-				newNode->value = v;
-				newNode->next = nullptr;
-				return;
-			}
-
-			/* find position */
-			first->lock.lock();
-			pred = first;
-			current = first->next;
-			(current != nullptr) ? current->lock.lock() : void();
+			/* find position
+			 * the next node is always locked before pred is released,
+			 * so no other thread can unlink or free current under us
+			 */
+			Layout::lock(&head);
+			pred = &head;
+			current = head.next.load(std::memory_order_relaxed);
+			lock_next(pred, current);
 			while (current != nullptr && current->value < v) {
-				pred->lock.unlock();
+				unlock_pred(pred, current);
 				pred = current;
-				current = current->next;
-				(current != nullptr) ? current->lock.lock() : void();
+				current = current->next.load(std::memory_order_relaxed);
+				lock_next(pred, current);
 			}
 
 			/* construct new node */
-			node<T> *newNode(new node<T>());
+			node<T> *newNode(Alloc::template create<node<T>>());
 			newNode->value = v;
 
-            /* insert new node between pred and current */
-			newNode->next = current;
-			(current != nullptr) ? current->lock.unlock() : void();
-			pred->next = newNode;
-			pred->lock.unlock();
+			/* insert new node between pred and current */
+			newNode->next.store(current, std::memory_order_relaxed);
+			unlock_next(pred, current);
+			versions::versioned(pred, [pred, newNode]() { pred->next.store(newNode, std::memory_order_release); });
+			Layout::unlock(pred);
 		}
 
 		void remove(T v) {
 			node<T> *pred;
 			node<T> *current;
 
-			if (first == nullptr) {
-				/* empty list */
-				return;
-			}
-
 			/* find position */
-			first->lock.lock();
-			pred = first;
-			current = first->next;
-			(current != nullptr) ? current->lock.lock() : void();
+			Layout::lock(&head);
+			pred = &head;
+			current = head.next.load(std::memory_order_relaxed);
+			lock_next(pred, current);
 			while (current != nullptr && current->value < v) {
-				pred->lock.unlock();
+				unlock_pred(pred, current);
 				pred = current;
-				current = current->next;
-				(current != nullptr) ? current->lock.lock() : void();
+				current = current->next.load(std::memory_order_relaxed);
+				lock_next(pred, current);
 			}
 
-			if (current == nullptr) {
+			if (current == nullptr || current->value != v) {
 				/* v not found */
-				pred->lock.unlock();
+				unlock_next(pred, current);
+				Layout::unlock(pred);
 				return;
 			}
 
-			if (current->value != v) {
-				/* v not found */
-				current->lock.unlock();
-				pred->lock.unlock();
-				return;
-			}
-
-			/* remove current */
-			pred->next = current->next;
-			pred->lock.unlock();
-			delete current;
+			/* remove current: mark it, then unlink it
+			 * any thread that locks its way to current would need pred's
+			 * lock first, but range scans may still read it, so it is
+			 * retired rather than freed
+			 */
+			versions::versioned(current, [current]() { current->marked.store(true, std::memory_order_release); });
+			versions::versioned(pred, [pred, current]() { pred->next.store(current->next.load(std::memory_order_relaxed), std::memory_order_release); });
+			unlock_next(pred, current);
+			Layout::unlock(pred);
+			Reclaim::retire(current, &Alloc::template destroy<node<T>>);
 		}
 
 		/* count elements with value v in the list */
 		std::size_t count(T v) {
 			std::size_t cnt = 0;
+			node<T> *pred;
 			node<T> *current;
 
-			if (first == nullptr) {
-                /* empty list */
-				return cnt;
-			}
-
 			/* first go to value v */
-			first->lock.lock();
-			current = first;
-			while(current != nullptr && current->value < v) {
-				current->lock.unlock();
-				current = current->next;
-				(current != nullptr) ? current->lock.lock() : void();
+			Layout::lock(&head);
+			pred = &head;
+			current = head.next.load(std::memory_order_relaxed);
+			lock_next(pred, current);
+			while (current != nullptr && current->value < v) {
+				unlock_pred(pred, current);
+				pred = current;
+				current = current->next.load(std::memory_order_relaxed);
+				lock_next(pred, current);
 			}
 
 			/* count elements */
-			while(current != nullptr && current->value == v) {
-				current->lock.unlock();
+			while (current != nullptr && current->value == v) {
 				cnt++;
-				current = current->next;
-				(current != nullptr) ? current->lock.lock() : void();
+				unlock_pred(pred, current);
+				pred = current;
+				current = current->next.load(std::memory_order_relaxed);
+				lock_next(pred, current);
 			}
 
-			(current != nullptr) ? current->lock.unlock() : void();
+			unlock_next(pred, current);
+			Layout::unlock(pred);
+			return cnt;
+		}
+
+		/* number of elements v with lo <= v <= hi, lock-free for updates */
+		std::size_t range_count(T lo, T hi) {
+			guard g;
+			std::size_t cnt = 0;
+			for (auto& seen : scan(lo, hi)) {
+				cnt += seen.marked ? 0 : 1;
+			}
 			return cnt;
 		}
+
+		/* all elements in ascending order, lock-free for updates */
+		std::vector<T> snapshot() {
+			guard g;
+			std::vector<T> values;
+			for (auto& seen : scan(std::numeric_limits<T>::lowest(), std::numeric_limits<T>::max())) {
+				(!seen.marked) ? values.push_back(seen.n->value) : void();
+			}
+			return values;
+		}
+
+		/* insert the n values in keys, sorted ascending, in one
+		 * hand-over-hand sweep
+		 */
+		void insert_batch(const T* keys, std::size_t n) {
+			node<T> *pred;
+			node<T> *current;
+			/* nodes inserted after pred are only reachable through pred,
+			 * so its lock also covers them and last, the latest of them
+			 */
+			node<T> *last;
+
+			Layout::lock(&head);
+			pred = &head;
+			last = pred;
+			current = head.next.load(std::memory_order_relaxed);
+			lock_next(pred, current);
+			for (std::size_t i = 0; i < n; i++) {
+				/* find position, continuing from the previous key */
+				while (current != nullptr && current->value < keys[i]) {
+					unlock_pred(pred, current);
+					pred = current;
+					last = current;
+					current = current->next.load(std::memory_order_relaxed);
+					lock_next(pred, current);
+				}
+
+				/* construct new node */
+				node<T> *newNode(Alloc::template create<node<T>>());
+				newNode->value = keys[i];
+
+				/* insert new node between last and current */
+				newNode->next.store(current, std::memory_order_relaxed);
+				versions::versioned(last, [last, newNode]() { last->next.store(newNode, std::memory_order_release); });
+				last = newNode;
+			}
+
+			unlock_next(pred, current);
+			Layout::unlock(pred);
+		}
+
+		/* remove the n values in keys, sorted ascending, in one
+		 * hand-over-hand sweep
+		 */
+		void remove_batch(const T* keys, std::size_t n) {
+			node<T> *pred;
+			node<T> *current;
+
+			Layout::lock(&head);
+			pred = &head;
+			current = head.next.load(std::memory_order_relaxed);
+			lock_next(pred, current);
+			for (std::size_t i = 0; i < n; i++) {
+				/* find position, continuing from the previous key */
+				while (current != nullptr && current->value < keys[i]) {
+					unlock_pred(pred, current);
+					pred = current;
+					current = current->next.load(std::memory_order_relaxed);
+					lock_next(pred, current);
+				}
+				if (current == nullptr || current->value != keys[i]) {
+					/* keys[i] not found */
+					continue;
+				}
+
+				/* remove current, but lock its successor first */
+				node<T> *next = current->next.load(std::memory_order_relaxed);
+				lock_next(current, next);
+				versions::versioned(current, [current]() { current->marked.store(true, std::memory_order_release); });
+				versions::versioned(pred, [pred, next]() { pred->next.store(next, std::memory_order_release); });
+				bool shared = Layout::same_lock(pred, current) || (next != nullptr && Layout::same_lock(current, next));
+				(!shared) ? Layout::unlock(current) : void();
+				Reclaim::retire(current, &Alloc::template destroy<node<T>>);
+				current = next;
+			}
+
+			unlock_next(pred, current);
+			Layout::unlock(pred);
+		}
+
+		/* count elements for the n values in keys, sorted ascending,
+		 * in one hand-over-hand sweep; counts[i] is the count of keys[i]
+		 */
+		void count_batch(const T* keys, std::size_t n, std::size_t* counts) {
+			node<T> *pred;
+			node<T> *current;
+
+			Layout::lock(&head);
+			pred = &head;
+			current = head.next.load(std::memory_order_relaxed);
+			lock_next(pred, current);
+			for (std::size_t i = 0; i < n; i++) {
+				if (i > 0 && keys[i] == keys[i - 1]) {
+					/* the run of keys[i] is already behind us */
+					counts[i] = counts[i - 1];
+					continue;
+				}
+				/* go to value keys[i] */
+				while (current != nullptr && current->value < keys[i]) {
+					unlock_pred(pred, current);
+					pred = current;
+					current = current->next.load(std::memory_order_relaxed);
+					lock_next(pred, current);
+				}
+				/* count elements */
+				std::size_t cnt = 0;
+				while (current != nullptr && current->value == keys[i]) {
+					cnt++;
+					unlock_pred(pred, current);
+					pred = current;
+					current = current->next.load(std::memory_order_relaxed);
+					lock_next(pred, current);
+				}
+				counts[i] = cnt;
+			}
+
+			unlock_next(pred, current);
+			Layout::unlock(pred);
+		}
 };
 
 #endif // lacpp_sorted_list_mutexlock_fine_hpp
\ No newline at end of file
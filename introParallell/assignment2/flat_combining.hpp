@@ -0,0 +1,112 @@
+#ifndef lacpp_sorted_list_flat_combining_hpp
+#define lacpp_sorted_list_flat_combining_hpp lacpp_sorted_list_flat_combining_hpp
+
+/* a flat-combining wrapper (Hendler, Incze, Shavit, Tzafrir) around the
+ * sorted list implementation by David Klaftenegger, 2015
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+#include "node_pool.hpp"
+#include "sequential_list.hpp"
+#include "thread_ids.hpp"
+
+/* sorted list with flat combining
+ * a thread publishes its operation in its own slot and then either waits
+ * for the result or, if it gets the lock, becomes the combiner and applies
+ * all published operations to the sequential list in one go; the list and
+ * the lock then stay in the combiner's cache for the whole batch
+ */
+template<typename T, typename Alloc = default_allocator>
+class sorted_list {
+	enum operation { NONE = 0, INSERT, REMOVE, COUNT };
+	/* scans over the slots per lock acquisition, stop early if one is idle */
+	static const int COMBINE_PASSES = 3;
+	/* spins before a waiting thread yields its processor */
+	static const int SPINS_BEFORE_YIELD = 1024;
+
+	/* written by the owner, then handed to the combiner through request */
+	struct alignas(64) slot {
+		std::atomic<int> request{NONE};
+		T value;
+		std::size_t result;
+	};
+
+	sequential::sorted_list<T, Alloc> list;
+	alignas(64) std::atomic<bool> locked{false};
+	thread_slots<slot> slots;
+
+	/* apply every published operation, returns how many there were */
+	int combine_pass() {
+		int served = 0;
+		int limit = thread_id_limit();
+		for(int i = 0; i < limit; i++) {
+			slot& s = slots[i];
+			int op = s.request.load(std::memory_order_acquire);
+			if(op == NONE) {
+				continue;
+			}
+			if(op == INSERT) {
+				list.insert(s.value);
+			} else if(op == REMOVE) {
+				list.remove(s.value);
+			} else {
+				s.result = list.count(s.value);
+			}
+			s.request.store(NONE, std::memory_order_release);
+			served++;
+		}
+		return served;
+	}
+
+	/* publish op on v and wait until some combiner has applied it */
+	std::size_t execute(int op, T v) {
+		slot& s = slots[current_thread_id()];
+		s.value = v;
+		s.request.store(op, std::memory_order_release);
+		int spins = 0;
+		while(s.request.load(std::memory_order_acquire) != NONE) {
+			if(!locked.load(std::memory_order_relaxed) && !locked.exchange(true, std::memory_order_acquire)) {
+				/* we are the combiner, our own slot is served as well */
+				for(int pass = 0; pass < COMBINE_PASSES && combine_pass() > 0; pass++) {
+				}
+				locked.store(false, std::memory_order_release);
+				continue;
+			}
+			if(++spins == SPINS_BEFORE_YIELD) {
+				/* the combiner may have been descheduled */
+				spins = 0;
+				std::this_thread::yield();
+			}
+		}
+		return s.result;
+	}
+
+	public:
+		/* default constructor only:
+		 * copying or moving a list would race with concurrent users
+		 */
+		sorted_list() = default;
+		sorted_list(const sorted_list<T, Alloc>& other) = delete;
+		sorted_list(sorted_list<T, Alloc>&& other) = delete;
+		sorted_list<T, Alloc>& operator=(const sorted_list<T, Alloc>& other) = delete;
+		sorted_list<T, Alloc>& operator=(sorted_list<T, Alloc>&& other) = delete;
+
+		/* insert v into the list */
+		void insert(T v) {
+			execute(INSERT, v);
+		}
+
+		void remove(T v) {
+			execute(REMOVE, v);
+		}
+
+		/* count elements with value v in the list */
+		std::size_t count(T v) {
+			return execute(COUNT, v);
+		}
+};
+
+#endif // lacpp_sorted_list_flat_combining_hpp
@@ -0,0 +1,204 @@
+#ifndef lacpp_sorted_list_mutexlock_lazy_hpp
+#define lacpp_sorted_list_mutexlock_lazy_hpp lacpp_sorted_list_mutexlock_lazy_hpp
+
+/* a lazily synchronized sorted list based on the sorted list
+ * implementation by David Klaftenegger, 2015
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+#include "locks.hpp"
+#include "node_pool.hpp"
+#include "node_version.hpp"
+#include "reclamation.hpp"
+
+/* struct for list nodes
+ * marked is set under the lock before a node is unlinked
+ * version is odd while the lock holder changes next or marked, and
+ * grows with every change, see node_version.hpp
+ */
+template<typename T, typename Lock>
+struct node {
+	T value;
+	Lock lock;
+	std::atomic<bool> marked{false};
+	std::atomic<node<T, Lock>*> next{nullptr};
+	std::atomic<std::uint64_t> version{0};
+};
+
+/* concurrent sorted singly-linked list using lazy synchronization
+ * like the optimistic list, but removal first marks a node as logically
+ * deleted, so validation is local and count() takes no locks at all
+ * unlinked nodes may still be traversed, Reclaim defers freeing them
+ * range_count() and snapshot() see the list at one instant without
+ * taking locks, from the node versions
+ */
+template<typename T, typename Lock = default_lock<std::mutex>, typename Reclaim = epoch_reclamation, typename Alloc = default_allocator>
+class sorted_list {
+	static_assert(!Reclaim::needs_validation, "lazy list traversals do not protect their hops");
+	template<typename U>
+	using node = ::node<U, Lock>;
+
+	typedef typename Reclaim::guard guard;
+	typedef node_versions<node<T>> versions;
+	typedef typename versions::seen_node seen_node;
+	/* sentinel: its lock guards the link to the first element */
+	node<T> head;
+
+	/* find the last node with value < v and its successor without locking */
+	void find(T v, node<T>*& pred, node<T>*& current) {
+		pred = &head;
+		current = head.next.load(std::memory_order_acquire);
+		while(current != nullptr && current->value < v) {
+			pred = current;
+			current = current->next.load(std::memory_order_acquire);
+		}
+	}
+
+	/* with pred and current locked: are both still linked and adjacent? */
+	bool validate(node<T>* pred, node<T>* current) {
+		return !pred->marked.load(std::memory_order_relaxed)
+			&& (current == nullptr || !current->marked.load(std::memory_order_relaxed))
+			&& pred->next.load(std::memory_order_relaxed) == current;
+	}
+
+	/* the elements v with lo <= v <= hi at one instant, see node_version.hpp */
+	std::vector<seen_node> scan(T lo, T hi) {
+		return versions::scan(lo, hi, [this, lo]() {
+			node<T>* pred;
+			node<T>* current;
+			find(lo, pred, current);
+			return pred;
+		});
+	}
+
+	/* lock pred and current (if any) and validate the pair
+	 * returns with both locked on success and nothing locked on failure
+	 */
+	bool lock_and_validate(node<T>* pred, node<T>* current) {
+		pred->lock.lock();
+		(current != nullptr) ? current->lock.lock() : void();
+		if(validate(pred, current)) {
+			return true;
+		}
+		(current != nullptr) ? current->lock.unlock() : void();
+		pred->lock.unlock();
+		return false;
+	}
+
+	public:
+		/* default constructor only:
+		 * copying or moving a list would race with concurrent users
+		 */
+		sorted_list() = default;
+		sorted_list(const sorted_list<T, Lock, Reclaim, Alloc>& other) = delete;
+		sorted_list(sorted_list<T, Lock, Reclaim, Alloc>&& other) = delete;
+		sorted_list<T, Lock, Reclaim, Alloc>& operator=(const sorted_list<T, Lock, Reclaim, Alloc>& other) = delete;
+		sorted_list<T, Lock, Reclaim, Alloc>& operator=(sorted_list<T, Lock, Reclaim, Alloc>&& other) = delete;
+		~sorted_list() {
+			node<T>* current = head.next.load(std::memory_order_relaxed);
+			while(current != nullptr) {
+				node<T>* next = current->next.load(std::memory_order_relaxed);
+				Alloc::template destroy<node<T>>(current);
+				current = next;
+			}
+		}
+
+		/* insert v into the list */
+		void insert(T v) {
+			/* construct new node */
+			node<T>* newNode = Alloc::template create<node<T>>();
+			newNode->value = v;
+
+			guard g;
+			node<T>* pred;
+			node<T>* current;
+			while(true) {
+				/* first find position */
+				find(v, pred, current);
+				if(!lock_and_validate(pred, current)) {
+					continue;
+				}
+				/* insert new node between pred and current */
+				newNode->next.store(current, std::memory_order_relaxed);
+				versions::versioned(pred, [pred, newNode]() { pred->next.store(newNode, std::memory_order_release); });
+				(current != nullptr) ? current->lock.unlock() : void();
+				pred->lock.unlock();
+				return;
+			}
+		}
+
+		void remove(T v) {
+			guard g;
+			node<T>* pred;
+			node<T>* current;
+			while(true) {
+				/* first find position */
+				find(v, pred, current);
+				if(!lock_and_validate(pred, current)) {
+					continue;
+				}
+				if(current == nullptr || current->value != v) {
+					/* v not found */
+					(current != nullptr) ? current->lock.unlock() : void();
+					pred->lock.unlock();
+					return;
+				}
+				/* logically remove current, then unlink it */
+				versions::versioned(current, [current]() { current->marked.store(true, std::memory_order_release); });
+				versions::versioned(pred, [pred, current]() { pred->next.store(current->next.load(std::memory_order_relaxed), std::memory_order_release); });
+				current->lock.unlock();
+				pred->lock.unlock();
+				Reclaim::retire(current, &Alloc::template destroy<node<T>>);
+				return;
+			}
+		}
+
+		/* count elements with value v in the list
+		 * wait-free: never locks and never writes to shared nodes
+		 */
+		std::size_t count(T v) {
+			guard g;
+			std::size_t cnt = 0;
+			/* first go to value v */
+			node<T>* current = head.next.load(std::memory_order_acquire);
+			while(current != nullptr && current->value < v) {
+				current = current->next.load(std::memory_order_acquire);
+			}
+			/* count elements that are not logically deleted */
+			while(current != nullptr && current->value == v) {
+				if(!current->marked.load(std::memory_order_acquire)) {
+					cnt++;
+				}
+				current = current->next.load(std::memory_order_acquire);
+			}
+			return cnt;
+		}
+
+		/* number of elements v with lo <= v <= hi, lock-free for updates */
+		std::size_t range_count(T lo, T hi) {
+			guard g;
+			std::size_t cnt = 0;
+			for(auto& seen : scan(lo, hi)) {
+				cnt += seen.marked ? 0 : 1;
+			}
+			return cnt;
+		}
+
+		/* all elements in ascending order, lock-free for updates */
+		std::vector<T> snapshot() {
+			guard g;
+			std::vector<T> values;
+			for(auto& seen : scan(std::numeric_limits<T>::lowest(), std::numeric_limits<T>::max())) {
+				(!seen.marked) ? values.push_back(seen.n->value) : void();
+			}
+			return values;
+		}
+};
+
+#endif // lacpp_sorted_list_mutexlock_lazy_hpp
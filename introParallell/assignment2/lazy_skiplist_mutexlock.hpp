@@ -0,0 +1,246 @@
+#ifndef lacpp_skiplist_mutexlock_lazy_hpp
+#define lacpp_skiplist_mutexlock_lazy_hpp lacpp_skiplist_mutexlock_lazy_hpp
+
+/* a lazily synchronized skip list with the interface of the sorted list
+ * implementation by David Klaftenegger, 2015
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <random>
+
+#include "locks.hpp"
+#include "node_pool.hpp"
+#include "reclamation.hpp"
+
+/* struct for skip list nodes
+ * a node is part of the set once fully_linked is set and until marked is set
+ */
+template<typename T, typename Lock>
+struct node {
+	T value;
+	int height;
+	Lock lock;
+	std::atomic<bool> marked{false};
+	std::atomic<bool> fully_linked{false};
+	std::atomic<node<T, Lock>*>* next;
+
+	node(T v, int h) : value(v), height(h), next(new std::atomic<node<T, Lock>*>[h]) {
+		for(int i = 0; i < h; i++) {
+			next[i].store(nullptr, std::memory_order_relaxed);
+		}
+	}
+	node(const node<T, Lock>& other) = delete;
+	node<T, Lock>& operator=(const node<T, Lock>& other) = delete;
+	~node() {
+		delete[] next;
+	}
+};
+
+/* concurrent skip list with the sorted_list interface
+ * searches take no locks, updates lock the predecessors on every level
+ * and validate them as in the lazy list; count() is wait-free
+ * nodes with equal values are ordered by address, so every node has a
+ * unique position and duplicates can be removed one at a time
+ */
+template<typename T, typename Lock = default_lock<std::mutex>, typename Reclaim = epoch_reclamation, typename Alloc = default_allocator>
+class sorted_list {
+	template<typename U>
+	using node = ::node<U, Lock>;
+
+	static_assert(!Reclaim::needs_validation, "skip list searches do not validate their hops");
+	typedef typename Reclaim::guard guard;
+
+	/* enough levels for about 2^MAX_LEVEL elements */
+	static const int MAX_LEVEL = 20;
+
+	/* sentinel with full height, its value is never looked at */
+	node<T> head{T(), MAX_LEVEL};
+
+	/* height of a new node: 1 + number of trailing 1 bits of a random number */
+	static int random_level() {
+		thread_local std::minstd_rand engine(std::random_device{}());
+		unsigned long bits = engine();
+		int level = 1;
+		while(level < MAX_LEVEL && (bits & 1)) {
+			level++;
+			bits >>= 1;
+		}
+		return level;
+	}
+
+	/* does n come before the position of (v, id)? */
+	static bool before(node<T>* n, T v, std::uintptr_t id) {
+		return n->value < v || (!(v < n->value) && reinterpret_cast<std::uintptr_t>(n) < id);
+	}
+
+	/* fill preds/succs with the nodes around (v, id) on every level
+	 * id 0 finds the position before all nodes with value v
+	 */
+	void find(T v, std::uintptr_t id, node<T>** preds, node<T>** succs) {
+		node<T>* pred = &head;
+		for(int level = MAX_LEVEL - 1; level >= 0; level--) {
+			node<T>* current = pred->next[level].load(std::memory_order_acquire);
+			while(current != nullptr && before(current, v, id)) {
+				pred = current;
+				current = current->next[level].load(std::memory_order_acquire);
+			}
+			preds[level] = pred;
+			succs[level] = current;
+		}
+	}
+
+	/* lock the predecessors on levels 0 to height - 1
+	 * a node that is predecessor on several levels is locked once
+	 * locking upwards means locking larger values first in every thread
+	 */
+	static void lock_preds(node<T>** preds, int height) {
+		for(int level = 0; level < height; level++) {
+			if(level == 0 || preds[level] != preds[level - 1]) {
+				preds[level]->lock.lock();
+			}
+		}
+	}
+
+	static void unlock_preds(node<T>** preds, int height) {
+		for(int level = 0; level < height; level++) {
+			if(level == 0 || preds[level] != preds[level - 1]) {
+				preds[level]->lock.unlock();
+			}
+		}
+	}
+
+	public:
+		/* default constructor only:
+		 * copying or moving a list would race with concurrent users
+		 */
+		sorted_list() = default;
+		sorted_list(const sorted_list<T, Lock, Reclaim, Alloc>& other) = delete;
+		sorted_list(sorted_list<T, Lock, Reclaim, Alloc>&& other) = delete;
+		sorted_list<T, Lock, Reclaim, Alloc>& operator=(const sorted_list<T, Lock, Reclaim, Alloc>& other) = delete;
+		sorted_list<T, Lock, Reclaim, Alloc>& operator=(sorted_list<T, Lock, Reclaim, Alloc>&& other) = delete;
+		~sorted_list() {
+			node<T>* current = head.next[0].load(std::memory_order_relaxed);
+			while(current != nullptr) {
+				node<T>* next = current->next[0].load(std::memory_order_relaxed);
+				Alloc::template destroy<node<T>>(current);
+				current = next;
+			}
+		}
+
+		/* insert v into the list */
+		void insert(T v) {
+			/* construct new node */
+			int height = random_level();
+			node<T>* newNode = Alloc::template create<node<T>>(v, height);
+			std::uintptr_t id = reinterpret_cast<std::uintptr_t>(newNode);
+
+			guard g;
+			node<T>* preds[MAX_LEVEL];
+			node<T>* succs[MAX_LEVEL];
+			while(true) {
+				/* first find position */
+				find(v, id, preds, succs);
+				lock_preds(preds, height);
+				bool valid = true;
+				for(int level = 0; valid && level < height; level++) {
+					valid = !preds[level]->marked.load(std::memory_order_relaxed)
+						&& (succs[level] == nullptr || !succs[level]->marked.load(std::memory_order_relaxed))
+						&& preds[level]->next[level].load(std::memory_order_relaxed) == succs[level];
+				}
+				if(!valid) {
+					unlock_preds(preds, height);
+					continue;
+				}
+				/* insert new node between preds and succs on every level */
+				for(int level = 0; level < height; level++) {
+					newNode->next[level].store(succs[level], std::memory_order_relaxed);
+				}
+				for(int level = 0; level < height; level++) {
+					preds[level]->next[level].store(newNode, std::memory_order_release);
+				}
+				newNode->fully_linked.store(true, std::memory_order_release);
+				unlock_preds(preds, height);
+				return;
+			}
+		}
+
+		void remove(T v) {
+			guard g;
+			node<T>* preds[MAX_LEVEL];
+			node<T>* succs[MAX_LEVEL];
+
+			/* first find a node with value v that is in the set and mark it */
+			find(v, 0, preds, succs);
+			node<T>* victim = succs[0];
+			while(true) {
+				if(victim == nullptr || v < victim->value) {
+					/* v not found */
+					return;
+				}
+				if(victim->fully_linked.load(std::memory_order_acquire) && !victim->marked.load(std::memory_order_acquire)) {
+					victim->lock.lock();
+					if(!victim->marked.load(std::memory_order_relaxed)) {
+						victim->marked.store(true, std::memory_order_release);
+						break;
+					}
+					victim->lock.unlock();
+				}
+				victim = victim->next[0].load(std::memory_order_acquire);
+			}
+
+			/* unlink victim on every level */
+			int height = victim->height;
+			std::uintptr_t id = reinterpret_cast<std::uintptr_t>(victim);
+			while(true) {
+				find(v, id, preds, succs);
+				lock_preds(preds, height);
+				bool valid = true;
+				for(int level = 0; valid && level < height; level++) {
+					valid = !preds[level]->marked.load(std::memory_order_relaxed)
+						&& preds[level]->next[level].load(std::memory_order_relaxed) == victim;
+				}
+				if(!valid) {
+					unlock_preds(preds, height);
+					continue;
+				}
+				for(int level = height - 1; level >= 0; level--) {
+					preds[level]->next[level].store(victim->next[level].load(std::memory_order_relaxed), std::memory_order_release);
+				}
+				unlock_preds(preds, height);
+				victim->lock.unlock();
+				Reclaim::retire(victim, &Alloc::template destroy<node<T>>);
+				return;
+			}
+		}
+
+		/* count elements with value v in the list
+		 * wait-free: never locks and never writes to shared nodes
+		 */
+		std::size_t count(T v) {
+			guard g;
+			std::size_t cnt = 0;
+			/* first go to value v */
+			node<T>* pred = &head;
+			node<T>* current = nullptr;
+			for(int level = MAX_LEVEL - 1; level >= 0; level--) {
+				current = pred->next[level].load(std::memory_order_acquire);
+				while(current != nullptr && current->value < v) {
+					pred = current;
+					current = current->next[level].load(std::memory_order_acquire);
+				}
+			}
+			/* count elements that are in the set */
+			while(current != nullptr && !(v < current->value)) {
+				if(current->fully_linked.load(std::memory_order_acquire) && !current->marked.load(std::memory_order_acquire)) {
+					cnt++;
+				}
+				current = current->next[0].load(std::memory_order_acquire);
+			}
+			return cnt;
+		}
+};
+
+#endif // lacpp_skiplist_mutexlock_lazy_hpp
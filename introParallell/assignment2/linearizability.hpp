@@ -0,0 +1,408 @@
+#ifndef lacpp_linearizability_hpp
+#define lacpp_linearizability_hpp lacpp_linearizability_hpp
+
+/* stress test with a linearizability check for sorted_list variants
+ *
+ * stress<List>() lets threads run random insert, remove, count and
+ * batched operations on small keys for a number of rounds. Every
+ * operation is recorded with the ticks of a shared counter taken before
+ * the call and after the return; an operation that returned before
+ * another one was called has to take effect first.
+ *
+ * The list is a multiset, and operations on different keys do not affect
+ * each other, so every key is checked on its own as a counter: insert
+ * adds one, remove takes one away if there is one, count returns the
+ * value. The check searches for an order of the key's operations that
+ * respects real time and explains every count (Wing & Gong, with the
+ * memoization of Lowe), starting from the count seen before the round
+ * and ending at the count seen after it, both read while no thread runs.
+ *
+ * Every key of a batch is recorded as an operation of its own that may
+ * take effect anywhere within the batch call, which is all that batch.hpp
+ * promises.
+ *
+ * stress_ranges<List>() checks range_count() and snapshot() (range.hpp)
+ * of lists that claim them to be atomic against an invariant instead:
+ * every updater owns tokens in [lo, hi] and inserts and removes keys just
+ * outside the range, mostly right below lo and above hi. During the first
+ * half of the scans the range holds exactly N elements, N the number of
+ * tokens. In the second half updaters also move a token by inserting its
+ * new key before removing the old one, so at any instant the range holds
+ * between N and N + updaters elements. The whole list never holds more
+ * than N + updaters.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "affinity.hpp"
+#include "batch.hpp"
+#include "range.hpp"
+
+/* operations of every thread in one round, and keys of one batch */
+static const int STRESS_OPS_PER_ROUND = 1000;
+static const std::size_t STRESS_BATCH_SIZE = 4;
+/* give up on one key after that many search states */
+static const std::size_t STRESS_SEARCH_LIMIT = 1000000;
+
+struct history_op {
+	enum kind_t {insert, remove, count} kind;
+	int key;
+	std::size_t result; // of count
+	std::uint64_t call;
+	std::uint64_t ret;
+	int thread;
+};
+
+namespace linearizability_detail {
+	enum class verdict {linearizable, violation, inconclusive};
+
+	/* the operations of one key, sorted by call */
+	class key_checker {
+		const std::vector<history_op>& ops;
+		std::size_t final_count;
+		std::vector<bool> done;
+		/* (done, count) pairs that are known to lead nowhere */
+		std::unordered_set<std::string> failed;
+		std::size_t states = 0;
+
+		std::string state(std::size_t c) const {
+			std::string s(done.size() / 8 + 1, '\0');
+			for(std::size_t i = 0; i < done.size(); i++) {
+				s[i / 8] |= static_cast<char>(done[i] << (i % 8));
+			}
+			return s + std::to_string(c);
+		}
+
+		bool search(std::size_t c, std::size_t remaining) {
+			if(remaining == 0) {
+				return c == final_count;
+			}
+			std::string s = state(c);
+			if(failed.count(s) != 0 || ++states > STRESS_SEARCH_LIMIT) {
+				return false;
+			}
+			/* candidates are called before the first pending return */
+			std::uint64_t first_ret = UINT64_MAX;
+			for(std::size_t i = 0; i < ops.size(); i++) {
+				first_ret = done[i] ? first_ret : std::min(first_ret, ops[i].ret);
+			}
+			for(std::size_t i = 0; i < ops.size() && ops[i].call < first_ret; i++) {
+				if(done[i]) {
+					continue;
+				}
+				std::size_t next = c;
+				switch(ops[i].kind) {
+					case history_op::insert:
+						next = c + 1;
+						break;
+					case history_op::remove:
+						next = c > 0 ? c - 1 : 0;
+						break;
+					case history_op::count:
+						if(ops[i].result != c) {
+							continue;
+						}
+						break;
+				}
+				done[i] = true;
+				bool found = search(next, remaining - 1);
+				done[i] = false;
+				if(found) {
+					return true;
+				}
+			}
+			failed.insert(s);
+			return false;
+		}
+
+		public:
+			key_checker(const std::vector<history_op>& ops, std::size_t final_count) : ops(ops), final_count(final_count), done(ops.size(), false) {}
+
+			verdict check(std::size_t initial_count) {
+				if(search(initial_count, ops.size())) {
+					return verdict::linearizable;
+				}
+				return states > STRESS_SEARCH_LIMIT ? verdict::inconclusive : verdict::violation;
+			}
+	};
+
+	static inline void print_history(std::ostream& out, const std::vector<history_op>& ops) {
+		static const char* names[3] = {u8"insert", u8"remove", u8"count"};
+		for(auto& op : ops) {
+			out << u8"  thread " << op.thread << u8" [" << op.call << u8", " << op.ret << u8"] "
+				<< names[op.kind] << u8"(" << op.key << u8")";
+			if(op.kind == history_op::count) {
+				out << u8" = " << op.result;
+			}
+			out << "\n";
+		}
+	}
+
+	/* size and order of snapshot(l), false if l has none */
+	template<typename List>
+	static auto take_snapshot(List& l, int lo, int hi, std::size_t& in_range, std::size_t& total, bool& sorted, int) -> decltype(l.snapshot(), bool()) {
+		std::vector<int> values = snapshot(l);
+		in_range = 0;
+		for(int v : values) {
+			in_range += (lo <= v && v <= hi) ? 1 : 0;
+		}
+		total = values.size();
+		sorted = std::is_sorted(values.begin(), values.end());
+		return true;
+	}
+
+	template<typename List>
+	static bool take_snapshot(List&, int, int, std::size_t&, std::size_t&, bool&, long) {
+		return false;
+	}
+
+	/* one thread's operations of one round */
+	template<typename List>
+	static void stress_worker(List& l, int thread, int key_range, unsigned int seed, std::atomic<std::uint64_t>& clock, std::atomic<bool>& go, std::vector<history_op>& history) {
+		std::mt19937 engine(seed);
+		std::uniform_int_distribution<int> keys(0, key_range - 1);
+		std::uniform_int_distribution<int> choice(0, 9);
+		while(!go.load(std::memory_order_acquire));
+		for(int i = 0; i < STRESS_OPS_PER_ROUND; i++) {
+			int c = choice(engine);
+			if(c < 9) {
+				/* 30% each of insert, remove and count */
+				history_op op = {static_cast<history_op::kind_t>(c / 3), keys(engine), 0, 0, 0, thread};
+				op.call = clock.fetch_add(1);
+				switch(op.kind) {
+					case history_op::insert:
+						l.insert(op.key);
+						break;
+					case history_op::remove:
+						l.remove(op.key);
+						break;
+					case history_op::count:
+						op.result = l.count(op.key);
+						break;
+				}
+				op.ret = clock.fetch_add(1);
+				history.push_back(op);
+			} else {
+				/* 10% batches, of one kind each */
+				int batch[STRESS_BATCH_SIZE];
+				std::size_t counts[STRESS_BATCH_SIZE];
+				for(auto& k : batch) {
+					k = keys(engine);
+				}
+				std::sort(batch, batch + STRESS_BATCH_SIZE);
+				auto kind = static_cast<history_op::kind_t>(choice(engine) % 3);
+				std::uint64_t call = clock.fetch_add(1);
+				switch(kind) {
+					case history_op::insert:
+						insert_batch(l, batch, STRESS_BATCH_SIZE);
+						break;
+					case history_op::remove:
+						remove_batch(l, batch, STRESS_BATCH_SIZE);
+						break;
+					case history_op::count:
+						count_batch(l, batch, STRESS_BATCH_SIZE, counts);
+						break;
+				}
+				std::uint64_t ret = clock.fetch_add(1);
+				for(std::size_t k = 0; k < STRESS_BATCH_SIZE; k++) {
+					history.push_back({kind, batch[k], kind == history_op::count ? counts[k] : 0, call, ret, thread});
+				}
+			}
+		}
+	}
+}
+
+/* run rounds of threadcnt threads on keys [0, key_range) of a new List,
+ * check every round and report on out; false on a violation
+ * thread t is pinned to cpus[t % size] unless cpus is empty
+ */
+template<typename List>
+bool stress(int threadcnt, int rounds, int key_range, const std::vector<int>& cpus, const std::string& identifier, std::ostream& out) {
+	using namespace linearizability_detail;
+	List l;
+	std::random_device rd;
+	std::mt19937 engine(rd());
+	/* start with about one element per key */
+	std::uniform_int_distribution<int> keys(0, key_range - 1);
+	for(int i = 0; i < key_range; i++) {
+		l.insert(keys(engine));
+	}
+	std::vector<std::size_t> counts(key_range);
+	for(int k = 0; k < key_range; k++) {
+		counts[k] = l.count(k);
+	}
+
+	std::atomic<std::uint64_t> clock(0);
+	std::size_t operations = 0;
+	std::size_t inconclusive = 0;
+	for(int round = 0; round < rounds; round++) {
+		std::atomic<bool> go(false);
+		std::vector<std::vector<history_op>> histories(threadcnt);
+		std::vector<std::thread> threads;
+		for(int t = 0; t < threadcnt; t++) {
+			histories[t].reserve(STRESS_OPS_PER_ROUND * STRESS_BATCH_SIZE);
+			int cpu = cpus.empty() ? -1 : cpus[t % cpus.size()];
+			auto seed = rd();
+			threads.emplace_back([&l, &clock, &go, &histories, t, cpu, key_range, seed]() {
+				if(cpu >= 0) {
+					pin_thread(cpu);
+				}
+				stress_worker(l, t, key_range, seed, clock, go, histories[t]);
+			});
+		}
+		go.store(true, std::memory_order_release);
+		for(auto& t : threads) {
+			t.join();
+		}
+
+		/* split the round by key */
+		std::vector<std::vector<history_op>> by_key(key_range);
+		for(auto& h : histories) {
+			for(auto& op : h) {
+				by_key[op.key].push_back(op);
+			}
+			operations += h.size();
+		}
+		for(int k = 0; k < key_range; k++) {
+			std::vector<history_op>& ops = by_key[k];
+			std::sort(ops.begin(), ops.end(), [](const history_op& a, const history_op& b) { return a.call < b.call; });
+			std::size_t final_count = l.count(k);
+			verdict v = key_checker(ops, final_count).check(counts[k]);
+			if(v == verdict::violation) {
+				out << identifier << u8" / threads: " << threadcnt << u8" - not linearizable in round " << round
+					<< u8": key " << k << u8" went from " << counts[k] << u8" to " << final_count << u8" elements with\n";
+				print_history(out, ops);
+				return false;
+			}
+			inconclusive += v == verdict::inconclusive ? 1 : 0;
+			counts[k] = final_count;
+		}
+	}
+	out << identifier << u8" / threads: " << threadcnt << u8" - linearizable: " << rounds << u8" rounds, "
+		<< operations << u8" operations on " << key_range << u8" keys";
+	if(inconclusive > 0) {
+		out << u8", " << inconclusive << u8" key histories too long to decide";
+	}
+	out << "\n";
+	return true;
+}
+
+/* check range_count() and snapshot() of List against the invariant above
+ * for rounds * STRESS_OPS_PER_ROUND scans on keys [0, key_range), with
+ * max(1, threadcnt - 1) updaters; false on a violation
+ */
+template<typename List>
+bool stress_ranges(int threadcnt, int rounds, int key_range, const std::vector<int>& cpus, const std::string& identifier, std::ostream& out) {
+	using namespace linearizability_detail;
+	if(!atomic_range_count<List, int>()) {
+		out << identifier << u8" / threads: " << threadcnt << u8" - range_count is per key, not checked\n";
+		return true;
+	}
+	const int lo = key_range / 4;
+	const int hi = key_range - key_range / 4 - 1;
+	const int updaters = std::max(1, threadcnt - 1);
+	/* two tokens per updater, or as many as fit */
+	const int tokens_per_updater = std::max(1, std::min(2, (hi - lo + 1) / updaters));
+	const std::size_t tokens = static_cast<std::size_t>(updaters * tokens_per_updater);
+
+	List l;
+	std::random_device rd;
+	std::vector<std::vector<int>> owned(updaters);
+	for(int u = 0; u < updaters; u++) {
+		for(int i = 0; i < tokens_per_updater; i++) {
+			owned[u].push_back(lo + (u * tokens_per_updater + i) % (hi - lo + 1));
+			l.insert(owned[u].back());
+		}
+	}
+
+	std::atomic<bool> stop(false);
+	std::atomic<bool> moving(false);
+	std::vector<std::thread> threads;
+	for(int u = 0; u < updaters; u++) {
+		int cpu = cpus.empty() ? -1 : cpus[(u + 1) % cpus.size()];
+		auto seed = rd();
+		threads.emplace_back([&l, &stop, &moving, &owned, u, cpu, seed, lo, hi, key_range]() {
+			if(cpu >= 0) {
+				pin_thread(cpu);
+			}
+			std::mt19937 engine(seed);
+			std::uniform_int_distribution<int> inside(lo, hi);
+			std::uniform_int_distribution<int> choice(0, 7);
+			std::vector<int>& mine = owned[u];
+			while(!stop.load(std::memory_order_relaxed)) {
+				int c = choice(engine);
+				if(c < 4 && moving.load(std::memory_order_relaxed)) {
+					/* move a token: insert first, then remove */
+					int& token = mine[engine() % mine.size()];
+					int next = inside(engine);
+					l.insert(next);
+					l.remove(token);
+					token = next;
+				} else {
+					/* outside the range, mostly on its edges */
+					int k = (c < 6) ? lo - 1 - c % 2 : hi + 1 + c % 2;
+					k = (c == 7 && lo > 0) ? static_cast<int>(engine() % lo) : k;
+					if(0 <= k && k < key_range) {
+						l.insert(k);
+						l.remove(k);
+					}
+				}
+			}
+		});
+	}
+
+	int cpu = cpus.empty() ? -1 : cpus[0];
+	if(cpu >= 0) {
+		pin_thread(cpu);
+	}
+	std::size_t scans = 0;
+	std::size_t snapshots = 0;
+	bool ok = true;
+	for(int i = 0; i < rounds * STRESS_OPS_PER_ROUND && ok; i++) {
+		if(i == rounds * STRESS_OPS_PER_ROUND / 2) {
+			moving.store(true, std::memory_order_relaxed);
+		}
+		/* elements of the range beyond the tokens, none while nothing moves */
+		std::size_t slack = moving.load(std::memory_order_relaxed) ? updaters : 0;
+		std::size_t cnt = range_count(l, lo, hi);
+		scans++;
+		if(cnt < tokens || cnt > tokens + slack) {
+			out << identifier << u8" / threads: " << threadcnt << u8" - range_count(" << lo << u8", " << hi << u8") = " << cnt
+				<< u8", but between " << tokens << u8" and " << tokens + slack << u8" elements were in the range\n";
+			ok = false;
+		}
+		std::size_t in_range;
+		std::size_t total;
+		bool sorted;
+		if(!ok || !take_snapshot(l, lo, hi, in_range, total, sorted, 0)) {
+			continue;
+		}
+		snapshots++;
+		if(!sorted || in_range < tokens || in_range > tokens + slack || total > tokens + updaters) {
+			out << identifier << u8" / threads: " << threadcnt << u8" - snapshot has " << total << u8" elements, "
+				<< in_range << u8" of them in [" << lo << u8", " << hi << u8"]" << (sorted ? u8"" : u8", not sorted")
+				<< u8", with " << tokens << u8" tokens and " << updaters << u8" updaters\n";
+			ok = false;
+		}
+	}
+	stop.store(true, std::memory_order_relaxed);
+	for(auto& t : threads) {
+		t.join();
+	}
+	if(ok) {
+		out << identifier << u8" / threads: " << threadcnt << u8" - consistent ranges: " << scans << u8" range_count and "
+			<< snapshots << u8" snapshot calls on [" << lo << u8", " << hi << u8"]\n";
+	}
+	return ok;
+}
+
+#endif // lacpp_linearizability_hpp
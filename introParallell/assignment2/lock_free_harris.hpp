@@ -0,0 +1,210 @@
+#ifndef lacpp_sorted_list_lockfree_hpp
+#define lacpp_sorted_list_lockfree_hpp lacpp_sorted_list_lockfree_hpp
+
+/* a lock-free sorted list (Harris/Michael) based on the sorted list
+ * implementation by David Klaftenegger, 2015
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "node_pool.hpp"
+#include "reclamation.hpp"
+
+/* struct for list nodes
+ * the lowest bit of next marks the node itself as logically deleted
+ */
+template<typename T>
+struct node {
+	T value;
+	std::atomic<node<T>*> next;
+};
+
+/* helpers for the mark bit stored in the next pointer */
+template<typename T>
+static inline bool is_marked(node<T>* p) {
+	return (reinterpret_cast<std::uintptr_t>(p) & 1) != 0;
+}
+
+template<typename T>
+static inline node<T>* get_marked(node<T>* p) {
+	return reinterpret_cast<node<T>*>(reinterpret_cast<std::uintptr_t>(p) | 1);
+}
+
+template<typename T>
+static inline node<T>* get_unmarked(node<T>* p) {
+	return reinterpret_cast<node<T>*>(reinterpret_cast<std::uintptr_t>(p) & ~static_cast<std::uintptr_t>(1));
+}
+
+/* lock-free sorted singly-linked list
+ * Reclaim decides when unlinked nodes are freed, see reclamation.hpp
+ */
+template<typename T, typename Reclaim = epoch_reclamation, typename Alloc = default_allocator>
+class sorted_list {
+	typedef typename Reclaim::guard guard;
+	std::atomic<node<T>*> first{nullptr};
+
+	/* find the first unmarked node with value >= v
+	 * physically unlinks marked nodes found on the way
+	 * on return *pred_next is the link pointing to current,
+	 * and both pred and current are protected by g
+	 */
+	void find(guard& g, T v, std::atomic<node<T>*>*& pred_next, node<T>*& current) {
+		int pred_slot, current_slot, succ_slot;
+		retry:
+		pred_slot = 0;
+		current_slot = 1;
+		succ_slot = 2;
+		pred_next = &first;
+		current = g.protect(current_slot, *pred_next);
+		while(current != nullptr) {
+			node<T>* succ = g.protect(succ_slot, current->next);
+			if(Reclaim::needs_validation && pred_next->load(std::memory_order_acquire) != current) {
+				/* current may have been unlinked before we protected it */
+				goto retry;
+			}
+			if(is_marked(succ)) {
+				/* current is logically deleted: help unlinking it */
+				node<T>* expected = current;
+				if(!pred_next->compare_exchange_strong(expected, get_unmarked(succ), std::memory_order_acq_rel, std::memory_order_acquire)) {
+					goto retry;
+				}
+				Reclaim::retire(current, &Alloc::template destroy<node<T>>);
+				current = get_unmarked(succ);
+				std::swap(current_slot, succ_slot);
+				continue;
+			}
+			if(!(current->value < v)) {
+				return;
+			}
+			pred_next = &current->next;
+			current = succ;
+			int free_slot = pred_slot;
+			pred_slot = current_slot;
+			current_slot = succ_slot;
+			succ_slot = free_slot;
+		}
+	}
+
+	public:
+		/* default constructor only:
+		 * copying or moving a list would race with concurrent users
+		 */
+		sorted_list() = default;
+		sorted_list(const sorted_list<T, Reclaim, Alloc>& other) = delete;
+		sorted_list(sorted_list<T, Reclaim, Alloc>&& other) = delete;
+		sorted_list<T, Reclaim, Alloc>& operator=(const sorted_list<T, Reclaim, Alloc>& other) = delete;
+		sorted_list<T, Reclaim, Alloc>& operator=(sorted_list<T, Reclaim, Alloc>&& other) = delete;
+		~sorted_list() {
+			node<T>* current = first.load(std::memory_order_relaxed);
+			while(current != nullptr) {
+				node<T>* next = get_unmarked(current->next.load(std::memory_order_relaxed));
+				Alloc::template destroy<node<T>>(current);
+				current = next;
+			}
+		}
+
+		/* insert v into the list */
+		void insert(T v) {
+			/* construct new node */
+			node<T>* current = Alloc::template create<node<T>>();
+			current->value = v;
+
+			guard g;
+			std::atomic<node<T>*>* pred_next;
+			node<T>* succ;
+			while(true) {
+				/* first find position */
+				find(g, v, pred_next, succ);
+				/* insert new node between pred and succ */
+				current->next.store(succ, std::memory_order_relaxed);
+				if(pred_next->compare_exchange_strong(succ, current, std::memory_order_release, std::memory_order_relaxed)) {
+					return;
+				}
+			}
+		}
+
+		void remove(T v) {
+			guard g;
+			std::atomic<node<T>*>* pred_next;
+			node<T>* current;
+			while(true) {
+				/* first find position */
+				find(g, v, pred_next, current);
+				if(current == nullptr || current->value != v) {
+					/* v not found */
+					return;
+				}
+				/* logically remove current by marking its next pointer */
+				node<T>* succ = current->next.load(std::memory_order_acquire);
+				if(is_marked(succ)) {
+					/* someone else removed it first: look again */
+					continue;
+				}
+				if(!current->next.compare_exchange_strong(succ, get_marked(succ), std::memory_order_acq_rel, std::memory_order_relaxed)) {
+					continue;
+				}
+				/* physically unlink, or leave it to the next find() */
+				node<T>* expected = current;
+				if(pred_next->compare_exchange_strong(expected, succ, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+					Reclaim::retire(current, &Alloc::template destroy<node<T>>);
+				} else {
+					find(g, v, pred_next, current);
+				}
+				return;
+			}
+		}
+
+		/* count elements with value v in the list
+		 * with epochs this never writes to shared memory and is wait-free;
+		 * hazard pointers need validated hops and may have to restart
+		 */
+		std::size_t count(T v) {
+			guard g;
+			std::size_t cnt;
+			std::atomic<node<T>*>* pred_next;
+			node<T>* current;
+			int pred_slot, current_slot, succ_slot;
+			retry:
+			cnt = 0;
+			pred_slot = 0;
+			current_slot = 1;
+			succ_slot = 2;
+			pred_next = &first;
+			current = g.protect(current_slot, *pred_next);
+			while(current != nullptr && !(v < current->value)) {
+				node<T>* succ = g.protect(succ_slot, current->next);
+				if(Reclaim::needs_validation && pred_next->load(std::memory_order_acquire) != current) {
+					goto retry;
+				}
+				if(is_marked(succ)) {
+					if(Reclaim::needs_validation) {
+						/* a marked predecessor would fail validation forever:
+						 * help unlinking current instead of walking over it */
+						node<T>* expected = current;
+						if(!pred_next->compare_exchange_strong(expected, get_unmarked(succ), std::memory_order_acq_rel, std::memory_order_acquire)) {
+							goto retry;
+						}
+						Reclaim::retire(current, &Alloc::template destroy<node<T>>);
+						current = get_unmarked(succ);
+						std::swap(current_slot, succ_slot);
+						continue;
+					}
+				} else if(!(current->value < v)) {
+					/* count elements with value v that are not logically deleted */
+					cnt++;
+				}
+				pred_next = &current->next;
+				current = get_unmarked(succ);
+				int free_slot = pred_slot;
+				pred_slot = current_slot;
+				current_slot = succ_slot;
+				succ_slot = free_slot;
+			}
+			return cnt;
+		}
+};
+
+#endif // lacpp_sorted_list_lockfree_hpp
@@ -0,0 +1,257 @@
+#ifndef lacpp_skiplist_lockfree_hpp
+#define lacpp_skiplist_lockfree_hpp lacpp_skiplist_lockfree_hpp
+
+/* a lock-free skip list (Fraser, Herlihy/Shavit) with the interface of the
+ * sorted list implementation by David Klaftenegger, 2015
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+
+#include "node_pool.hpp"
+#include "reclamation.hpp"
+
+/* struct for skip list nodes
+ * the lowest bit of next[i] marks the node as deleted on level i,
+ * the mark on level 0 decides which remove() owns the node
+ */
+template<typename T>
+struct node {
+	T value;
+	int height;
+	/* inserter and remover each hold one, see sorted_list::release() */
+	std::atomic<int> owners{2};
+	std::atomic<node<T>*>* next;
+
+	node(T v, int h) : value(v), height(h), next(new std::atomic<node<T>*>[h]) {
+		for(int i = 0; i < h; i++) {
+			next[i].store(nullptr, std::memory_order_relaxed);
+		}
+	}
+	node(const node<T>& other) = delete;
+	node<T>& operator=(const node<T>& other) = delete;
+	~node() {
+		delete[] next;
+	}
+};
+
+/* helpers for the mark bit stored in the next pointers */
+template<typename T>
+static inline bool is_marked(node<T>* p) {
+	return (reinterpret_cast<std::uintptr_t>(p) & 1) != 0;
+}
+
+template<typename T>
+static inline node<T>* get_marked(node<T>* p) {
+	return reinterpret_cast<node<T>*>(reinterpret_cast<std::uintptr_t>(p) | 1);
+}
+
+template<typename T>
+static inline node<T>* get_unmarked(node<T>* p) {
+	return reinterpret_cast<node<T>*>(reinterpret_cast<std::uintptr_t>(p) & ~static_cast<std::uintptr_t>(1));
+}
+
+/* lock-free skip list with the sorted_list interface
+ * level 0 is a Harris list that defines the set, the upper levels are
+ * shortcuts that are linked after and unlinked before level 0
+ * nodes with equal values are ordered by address, so every node has a
+ * unique position and duplicates can be removed one at a time
+ */
+template<typename T, typename Reclaim = epoch_reclamation, typename Alloc = default_allocator>
+class sorted_list {
+	static_assert(!Reclaim::needs_validation, "skip list searches do not validate their hops");
+	typedef typename Reclaim::guard guard;
+
+	/* enough levels for about 2^MAX_LEVEL elements */
+	static const int MAX_LEVEL = 20;
+
+	/* sentinel with full height, its value is never looked at */
+	node<T> head{T(), MAX_LEVEL};
+
+	/* height of a new node: 1 + number of trailing 1 bits of a random number */
+	static int random_level() {
+		thread_local std::minstd_rand engine(std::random_device{}());
+		unsigned long bits = engine();
+		int level = 1;
+		while(level < MAX_LEVEL && (bits & 1)) {
+			level++;
+			bits >>= 1;
+		}
+		return level;
+	}
+
+	/* does n come before the position of (v, id)? */
+	static bool before(node<T>* n, T v, std::uintptr_t id) {
+		return n->value < v || (!(v < n->value) && reinterpret_cast<std::uintptr_t>(n) < id);
+	}
+
+	/* fill preds/succs with the unmarked nodes around (v, id) on every level
+	 * physically unlinks marked nodes found on the way
+	 * id 0 finds the position before all nodes with value v
+	 */
+	void find(T v, std::uintptr_t id, node<T>** preds, node<T>** succs) {
+		retry:
+		node<T>* pred = &head;
+		for(int level = MAX_LEVEL - 1; level >= 0; level--) {
+			node<T>* current = get_unmarked(pred->next[level].load(std::memory_order_acquire));
+			while(current != nullptr) {
+				node<T>* succ = current->next[level].load(std::memory_order_acquire);
+				if(is_marked(succ)) {
+					/* current is being removed: help unlinking it on this level */
+					node<T>* expected = current;
+					if(!pred->next[level].compare_exchange_strong(expected, get_unmarked(succ), std::memory_order_acq_rel, std::memory_order_acquire)) {
+						goto retry;
+					}
+					current = get_unmarked(succ);
+					continue;
+				}
+				if(!before(current, v, id)) {
+					break;
+				}
+				pred = current;
+				current = succ;
+			}
+			preds[level] = pred;
+			succs[level] = current;
+		}
+	}
+
+	/* drop one reference to n
+	 * the inserter may still link upper levels of a node that is already
+	 * being removed, so only the last of inserter and remover can be sure
+	 * that a final find() leaves n unreachable and n can be retired
+	 */
+	void release(node<T>* n) {
+		if(n->owners.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			node<T>* preds[MAX_LEVEL];
+			node<T>* succs[MAX_LEVEL];
+			find(n->value, reinterpret_cast<std::uintptr_t>(n), preds, succs);
+			Reclaim::retire(n, &Alloc::template destroy<node<T>>);
+		}
+	}
+
+	public:
+		/* default constructor only:
+		 * copying or moving a list would race with concurrent users
+		 */
+		sorted_list() = default;
+		sorted_list(const sorted_list<T, Reclaim, Alloc>& other) = delete;
+		sorted_list(sorted_list<T, Reclaim, Alloc>&& other) = delete;
+		sorted_list<T, Reclaim, Alloc>& operator=(const sorted_list<T, Reclaim, Alloc>& other) = delete;
+		sorted_list<T, Reclaim, Alloc>& operator=(sorted_list<T, Reclaim, Alloc>&& other) = delete;
+		~sorted_list() {
+			node<T>* current = get_unmarked(head.next[0].load(std::memory_order_relaxed));
+			while(current != nullptr) {
+				node<T>* next = get_unmarked(current->next[0].load(std::memory_order_relaxed));
+				Alloc::template destroy<node<T>>(current);
+				current = next;
+			}
+		}
+
+		/* insert v into the list */
+		void insert(T v) {
+			/* construct new node */
+			int height = random_level();
+			node<T>* newNode = Alloc::template create<node<T>>(v, height);
+			std::uintptr_t id = reinterpret_cast<std::uintptr_t>(newNode);
+
+			guard g;
+			node<T>* preds[MAX_LEVEL];
+			node<T>* succs[MAX_LEVEL];
+			while(true) {
+				/* first find position */
+				find(v, id, preds, succs);
+				for(int level = 0; level < height; level++) {
+					newNode->next[level].store(succs[level], std::memory_order_relaxed);
+				}
+				/* linking level 0 adds v to the set */
+				node<T>* expected = succs[0];
+				if(preds[0]->next[0].compare_exchange_strong(expected, newNode, std::memory_order_release, std::memory_order_relaxed)) {
+					break;
+				}
+			}
+
+			/* link the upper levels, unless a remove() got there first */
+			for(int level = 1; level < height; level++) {
+				while(true) {
+					node<T>* succ = newNode->next[level].load(std::memory_order_acquire);
+					if(is_marked(succ)) {
+						release(newNode);
+						return;
+					}
+					if(succ != succs[level] && !newNode->next[level].compare_exchange_strong(succ, succs[level], std::memory_order_acq_rel, std::memory_order_acquire)) {
+						/* only remove() changes next of a linked node: it is marked */
+						release(newNode);
+						return;
+					}
+					node<T>* expected = succs[level];
+					if(preds[level]->next[level].compare_exchange_strong(expected, newNode, std::memory_order_release, std::memory_order_relaxed)) {
+						break;
+					}
+					find(v, id, preds, succs);
+				}
+			}
+			release(newNode);
+		}
+
+		void remove(T v) {
+			guard g;
+			node<T>* preds[MAX_LEVEL];
+			node<T>* succs[MAX_LEVEL];
+			while(true) {
+				/* first find position */
+				find(v, 0, preds, succs);
+				node<T>* victim = succs[0];
+				if(victim == nullptr || v < victim->value) {
+					/* v not found */
+					return;
+				}
+				/* mark the upper levels top down, then race for level 0 */
+				for(int level = victim->height - 1; level >= 1; level--) {
+					node<T>* succ = victim->next[level].load(std::memory_order_acquire);
+					while(!is_marked(succ) && !victim->next[level].compare_exchange_weak(succ, get_marked(succ), std::memory_order_acq_rel, std::memory_order_acquire)) {
+					}
+				}
+				node<T>* succ = victim->next[0].load(std::memory_order_acquire);
+				while(!is_marked(succ)) {
+					if(victim->next[0].compare_exchange_strong(succ, get_marked(succ), std::memory_order_acq_rel, std::memory_order_acquire)) {
+						/* logically removed by us */
+						release(victim);
+						return;
+					}
+				}
+				/* someone else removed it first: look again */
+			}
+		}
+
+		/* count elements with value v in the list
+		 * wait-free: never writes to shared memory
+		 */
+		std::size_t count(T v) {
+			guard g;
+			std::size_t cnt = 0;
+			/* first go to value v */
+			node<T>* pred = &head;
+			node<T>* current = nullptr;
+			for(int level = MAX_LEVEL - 1; level >= 0; level--) {
+				current = get_unmarked(pred->next[level].load(std::memory_order_acquire));
+				while(current != nullptr && current->value < v) {
+					pred = current;
+					current = get_unmarked(current->next[level].load(std::memory_order_acquire));
+				}
+			}
+			/* count elements that are not logically deleted */
+			while(current != nullptr && !(v < current->value)) {
+				node<T>* succ = current->next[0].load(std::memory_order_acquire);
+				if(!is_marked(succ)) {
+					cnt++;
+				}
+				current = get_unmarked(succ);
+			}
+			return cnt;
+		}
+};
+
+#endif // lacpp_skiplist_lockfree_hpp
@@ -0,0 +1,278 @@
+#ifndef lacpp_lock_stats_hpp
+#define lacpp_lock_stats_hpp lacpp_lock_stats_hpp
+
+/* optional lock contention statistics
+ *
+ * Compiling with -DLIST_LOCK_STATS wraps the lock of every list in
+ * profiled<Lock>, which records per lock type:
+ *   acquisitions        calls of lock() (and lock_shared())
+ *   contended           acquisitions that had to wait: the lock spun at
+ *                       least once, or (for locks without spin hooks such
+ *                       as std::mutex) waited longer than CONTENDED_NS
+ *   spins               spin iterations, counted by cpu_relax()
+ *   wait and hold time  histograms with power-of-two buckets in ns,
+ *                       hold times only for exclusive acquisitions
+ * Counters are kept per thread and added to the totals when the thread
+ * exits, so the hot path never writes shared memory. benchmark() resets
+ * the totals before and prints them after every run; warm-up is not
+ * counted.
+ *
+ * Without LIST_LOCK_STATS profiled_lock<Lock> is Lock and all hooks are
+ * empty.
+ */
+
+#include <ostream>
+#include <string>
+
+#ifdef LIST_LOCK_STATS
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <mutex>
+#include <typeinfo>
+#include <utility>
+
+namespace lock_stats_detail {
+	/* lock types that can be told apart */
+	static const int MAX_TYPES = 16;
+	/* bucket i counts times in [2^(i-1), 2^i) ns, bucket 0 counts 0 ns */
+	static const int BUCKETS = 40;
+	static const std::uint64_t CONTENDED_NS = 1000;
+
+	struct counters {
+		std::uint64_t acquisitions;
+		std::uint64_t contended;
+		std::uint64_t spins;
+		std::uint64_t holds;
+		std::uint64_t wait_ns;
+		std::uint64_t hold_ns;
+		std::uint64_t wait_hist[BUCKETS];
+		std::uint64_t hold_hist[BUCKETS];
+
+		void add(const counters& other) {
+			acquisitions += other.acquisitions;
+			contended += other.contended;
+			spins += other.spins;
+			holds += other.holds;
+			wait_ns += other.wait_ns;
+			hold_ns += other.hold_ns;
+			for(int i = 0; i < BUCKETS; i++) {
+				wait_hist[i] += other.wait_hist[i];
+				hold_hist[i] += other.hold_hist[i];
+			}
+		}
+	};
+
+	static inline int bucket(std::uint64_t ns) {
+		int b = ns == 0 ? 0 : 64 - __builtin_clzll(ns);
+		return b < BUCKETS ? b : BUCKETS - 1;
+	}
+
+	static inline std::uint64_t now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/* totals of all exited threads */
+	class registry {
+		std::mutex lock;
+		std::atomic<int> types{0};
+		std::string names[MAX_TYPES];
+		counters totals[MAX_TYPES] = {};
+
+		public:
+			/* never destroyed: threads may exit after static destruction */
+			static registry& instance() {
+				static registry* r = new registry();
+				return *r;
+			}
+
+			int add_type(const char* mangled) {
+				std::lock_guard<std::mutex> guard(lock);
+				int t = types.load(std::memory_order_relaxed);
+				if(t == MAX_TYPES) {
+					/* share the last entry */
+					names[MAX_TYPES - 1] = "(other locks)";
+					return MAX_TYPES - 1;
+				}
+				int status = 0;
+				char* name = abi::__cxa_demangle(mangled, nullptr, nullptr, &status);
+				names[t] = status == 0 ? name : mangled;
+				std::free(name);
+				types.store(t + 1, std::memory_order_release);
+				return t;
+			}
+
+			void flush(counters* local) {
+				std::lock_guard<std::mutex> guard(lock);
+				for(int t = 0; t < MAX_TYPES; t++) {
+					totals[t].add(local[t]);
+					local[t] = counters();
+				}
+			}
+
+			void reset(counters* local) {
+				std::lock_guard<std::mutex> guard(lock);
+				for(int t = 0; t < MAX_TYPES; t++) {
+					totals[t] = counters();
+					local[t] = counters();
+				}
+			}
+
+			void dump(std::ostream& out, const std::string& identifier, counters* local);
+	};
+
+	/* the calling thread's counters, flushed when it exits */
+	struct thread_counters {
+		counters c[MAX_TYPES] = {};
+		std::uint64_t spins = 0;
+		~thread_counters() {
+			registry::instance().flush(c);
+		}
+	};
+
+	static inline thread_counters& local() {
+		thread_local thread_counters t;
+		return t;
+	}
+
+	inline void registry::dump(std::ostream& out, const std::string& identifier, counters* mine) {
+		std::lock_guard<std::mutex> guard(lock);
+		int n = types.load(std::memory_order_relaxed);
+		for(int t = 0; t < n; t++) {
+			counters c = totals[t];
+			c.add(mine[t]);
+			if(c.acquisitions == 0) {
+				continue;
+			}
+			out << identifier << u8" / lock " << names[t]
+				<< u8": acquisitions " << c.acquisitions
+				<< u8", contended " << c.contended
+				<< u8", spins " << c.spins
+				<< u8", avg wait ns " << c.wait_ns / c.acquisitions
+				<< u8", avg hold ns " << (c.holds != 0 ? c.hold_ns / c.holds : 0) << "\n";
+			const char* kinds[2] = {u8"wait", u8"hold"};
+			const std::uint64_t* hists[2] = {c.wait_hist, c.hold_hist};
+			for(int k = 0; k < (c.holds != 0 ? 2 : 1); k++) {
+				out << identifier << u8" / lock " << names[t] << u8": " << kinds[k] << u8" ns histogram";
+				for(int b = 0; b < BUCKETS; b++) {
+					if(hists[k][b] != 0) {
+						out << u8" <" << (std::uint64_t(1) << b) << u8":" << hists[k][b];
+					}
+				}
+				out << "\n";
+			}
+		}
+	}
+
+	/* index of the lock type Lock in the counter tables */
+	template<typename Lock>
+	static int type_index() {
+		static const int index = registry::instance().add_type(typeid(Lock).name());
+		return index;
+	}
+}
+
+/* Lock with statistics, forwards the shared and optimistic read
+ * operations of RWLock and SeqLock when they are used
+ */
+template<typename Lock>
+class profiled {
+	Lock inner;
+	/* written by the holder only, shared holders are not timed */
+	std::uint64_t acquired_at = 0;
+
+	/* time a lock()-like call and count it */
+	template<typename Acquire>
+	static std::uint64_t acquire(Acquire a) {
+		using namespace lock_stats_detail;
+		thread_counters& l = local();
+		std::uint64_t spins = l.spins;
+		std::uint64_t start = now();
+		a();
+		std::uint64_t end = now();
+		counters& c = l.c[type_index<Lock>()];
+		std::uint64_t wait = end - start;
+		spins = l.spins - spins;
+		c.acquisitions++;
+		c.contended += (spins > 0 || wait >= CONTENDED_NS) ? 1 : 0;
+		c.spins += spins;
+		c.wait_ns += wait;
+		c.wait_hist[bucket(wait)]++;
+		return end;
+	}
+
+	public:
+		void lock() {
+			acquired_at = acquire([this]() { inner.lock(); });
+		}
+
+		void unlock() {
+			using namespace lock_stats_detail;
+			std::uint64_t hold = now() - acquired_at;
+			counters& c = local().c[type_index<Lock>()];
+			c.holds++;
+			c.hold_ns += hold;
+			c.hold_hist[bucket(hold)]++;
+			inner.unlock();
+		}
+
+		void lock_shared() {
+			acquire([this]() { inner.lock_shared(); });
+		}
+
+		void unlock_shared() {
+			inner.unlock_shared();
+		}
+
+		template<typename L = Lock>
+		auto read_begin() const -> decltype(std::declval<const L&>().read_begin()) {
+			return inner.read_begin();
+		}
+
+		template<typename S>
+		bool read_validate(S s) const {
+			return inner.read_validate(s);
+		}
+};
+
+template<typename Lock>
+using profiled_lock = profiled<Lock>;
+
+/* called by cpu_relax() in every spin iteration */
+static inline void lock_stats_spin() {
+	lock_stats_detail::local().spins++;
+}
+
+static inline void lock_stats_reset() {
+	lock_stats_detail::registry::instance().reset(lock_stats_detail::local().c);
+}
+
+/* forget what the calling thread counted so far, e.g. during warm-up */
+static inline void lock_stats_reset_thread() {
+	for(auto& c : lock_stats_detail::local().c) {
+		c = lock_stats_detail::counters();
+	}
+}
+
+static inline void lock_stats_dump(std::ostream& out, const std::string& identifier) {
+	lock_stats_detail::registry::instance().dump(out, identifier, lock_stats_detail::local().c);
+}
+
+#else
+
+template<typename Lock>
+using profiled_lock = Lock;
+
+static inline void lock_stats_spin() {}
+
+static inline void lock_stats_reset() {}
+
+static inline void lock_stats_reset_thread() {}
+
+static inline void lock_stats_dump(std::ostream&, const std::string&) {}
+
+#endif // LIST_LOCK_STATS
+
+#endif // lacpp_lock_stats_hpp
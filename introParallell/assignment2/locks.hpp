@@ -0,0 +1,546 @@
+#ifndef lacpp_locks_hpp
+#define lacpp_locks_hpp lacpp_locks_hpp
+
+/* spin locks for the sorted lists
+ *
+ * All locks satisfy BasicLockable (lock() and unlock()), so any of them
+ * (or std::mutex) can be given to a list as its Lock parameter, or to a
+ * node layout for the fine-grained lists:
+ *   TASLock           test-and-set
+ *   TATASLock         test-and-test-and-set
+ *   BackoffLock       test-and-test-and-set with exponential backoff
+ *   TicketLock        FIFO, one shared counter pair
+ *   CLHLock           FIFO queue lock, spins on the predecessor's node
+ *   MCSLock           FIFO queue lock, spins on its own node
+ *   CohortLock<>      cohort lock (Dice, Marathe, Shavit) that hands the
+ *                     lock to waiters of the same cluster first
+ *   AdaptiveLock      spins for a bounded budget, then sleeps on a futex
+ *   AdaptiveMCSLock   MCS whose waiters sleep on their node after spinning
+ *
+ * The pure spin locks only work well with at most one thread per core:
+ * a spinner that got preempted keeps the lock holder (or, for the FIFO
+ * locks, the next holder) from running. The adaptive locks stop burning
+ * the processor after SPIN_LIMIT rounds and are meant for oversubscribed
+ * runs.
+ *
+ * The MCS locks take their queue nodes from a small array preallocated per
+ * thread, so lock() and unlock() never touch the heap, also while a thread
+ * holds several locks (as in hand-over-hand locking). CLH nodes move from
+ * thread to thread, so CLHLock recycles them through a per-thread free list.
+ *
+ * Compiling with -DLIST_LOCK=<lock> changes the default lock of every list,
+ * -DLIST_LOCK_STATS adds contention statistics to it (see lock_stats.hpp).
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <sched.h>
+#include <thread>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "lock_stats.hpp"
+
+/* tell the processor we are spinning */
+static inline void cpu_relax() {
+    lock_stats_spin();
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#endif
+}
+
+/* sleep while *word == expected, wake up to n sleepers on word
+ * without futexes the waiter only yields, so callers must re-check
+ */
+static inline void futex_wait(std::atomic<int>* word, int expected) {
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<int*>(word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+    (void) word;
+    (void) expected;
+    std::this_thread::yield();
+#endif
+}
+
+static inline void futex_wake(std::atomic<int>* word, int n) {
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<int*>(word), FUTEX_WAKE_PRIVATE, n, nullptr, nullptr, 0);
+#else
+    (void) word;
+    (void) n;
+#endif
+}
+
+class TASLock {
+    std::atomic<bool> flag{false};
+
+public:
+    void lock() {
+        while (flag.exchange(true, std::memory_order_acquire)) {
+            /* every attempt writes the lock's cache line */
+            cpu_relax();
+        }
+    }
+
+    void unlock() {
+        flag.store(false, std::memory_order_release);
+    }
+};
+
+class TATASLock {
+    std::atomic<bool> flag;
+
+public:
+    TATASLock() : flag(false) {}
+
+    void lock() {
+        while (true) {
+            while (flag.load(std::memory_order_relaxed)) {
+                /* keep spinning until the lock seems available */
+                cpu_relax();
+            }
+            if (!flag.exchange(true, std::memory_order_acquire)) {
+                /* acquire the lock */
+                return;
+            }
+        }
+    }
+
+    void unlock() {
+        flag.store(false, std::memory_order_release);
+    }
+};
+
+/* TATAS that waits exponentially longer after every failed attempt,
+ * so that fewer threads race for the line each time the lock is released
+ */
+class BackoffLock {
+    static const unsigned MIN_DELAY = 4;
+    static const unsigned MAX_DELAY = 1024;
+
+    std::atomic<bool> flag{false};
+
+public:
+    void lock() {
+        unsigned delay = MIN_DELAY;
+        while (true) {
+            while (flag.load(std::memory_order_relaxed)) {
+                cpu_relax();
+            }
+            if (!flag.exchange(true, std::memory_order_acquire)) {
+                return;
+            }
+            for (unsigned i = 0; i < delay; i++) {
+                cpu_relax();
+            }
+            delay = delay < MAX_DELAY ? 2 * delay : MAX_DELAY;
+        }
+    }
+
+    void unlock() {
+        flag.store(false, std::memory_order_release);
+    }
+};
+
+/* threads are served in the order they drew their ticket
+ * unlock() does not need to run in the thread that called lock()
+ */
+class TicketLock {
+    std::atomic<unsigned> next{0};
+    std::atomic<unsigned> owner{0};
+
+public:
+    void lock() {
+        unsigned ticket = next.fetch_add(1, std::memory_order_relaxed);
+        while (owner.load(std::memory_order_acquire) != ticket) {
+            cpu_relax();
+        }
+    }
+
+    void unlock() {
+        owner.store(owner.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /* only for the holder: are other threads waiting? */
+    bool has_waiters() const {
+        return next.load(std::memory_order_relaxed) != owner.load(std::memory_order_relaxed) + 1;
+    }
+};
+
+/* per-thread free list of queue nodes of type N (with a member pool_next)
+ * for locks whose nodes change hands (CLH): nodes are recycled instead
+ * of being allocated and deleted on every acquire/release
+ */
+template<typename N>
+class QueueNodePool {
+    N* free = nullptr;
+
+    QueueNodePool() = default;
+
+public:
+    ~QueueNodePool() {
+        while (free != nullptr) {
+            N* next = free->pool_next;
+            delete free;
+            free = next;
+        }
+    }
+
+    static N* get() {
+        QueueNodePool& p = instance();
+        N* n = p.free;
+        if (n != nullptr) {
+            p.free = n->pool_next;
+            return n;
+        }
+        return new N();
+    }
+
+    static void put(N* n) {
+        QueueNodePool& p = instance();
+        n->pool_next = p.free;
+        p.free = n;
+    }
+
+private:
+    static QueueNodePool& instance() {
+        thread_local QueueNodePool p;
+        return p;
+    }
+};
+
+/* per-thread array of DEPTH queue nodes of type N
+ * for locks whose node returns to the thread that took it (MCS): a thread
+ * can hold up to DEPTH such locks at a time and release them in any
+ * order; a bit mask keeps track of the nodes in use
+ */
+template<typename N, unsigned DEPTH = 32>
+class QueueNodeStack {
+    static_assert(DEPTH <= 32, "one bit per node in used");
+
+    N nodes[DEPTH];
+    std::uint32_t used = 0;
+
+    static QueueNodeStack& instance() {
+        thread_local QueueNodeStack s;
+        return s;
+    }
+
+public:
+    static N* get() {
+        QueueNodeStack& s = instance();
+        std::uint32_t all = DEPTH == 32 ? ~std::uint32_t(0) : (std::uint32_t(1) << DEPTH) - 1;
+        if (s.used != all) {
+            unsigned i = __builtin_ctz(~s.used);
+            s.used |= std::uint32_t(1) << i;
+            return &s.nodes[i];
+        }
+        /* more than DEPTH locks held at once */
+        return new N();
+    }
+
+    static void put(N* n) {
+        QueueNodeStack& s = instance();
+        std::uintptr_t p = reinterpret_cast<std::uintptr_t>(n);
+        std::uintptr_t base = reinterpret_cast<std::uintptr_t>(s.nodes);
+        if (p >= base && p < base + sizeof(s.nodes)) {
+            s.used &= ~(std::uint32_t(1) << (n - s.nodes));
+        } else {
+            delete n;
+        }
+    }
+};
+
+/* the queue is implicit: every thread spins on the node of its predecessor
+ * and on unlock() takes over that node, while its own node stays in the
+ * queue until the successor is done with it
+ */
+class CLHLock {
+    struct CLHLockNode {
+        std::atomic<bool> locked{false};
+        CLHLockNode* pool_next = nullptr;
+    };
+
+    std::atomic<CLHLockNode*> tail;
+    CLHLockNode* holder = nullptr; // node of the current lock holder
+    CLHLockNode* holder_pred = nullptr; // node the holder waited on
+
+public:
+    /* the queue starts with an unlocked node, the lock owns the last node */
+    CLHLock() : tail(new CLHLockNode()) {}
+    CLHLock(const CLHLock& other) = delete;
+    CLHLock& operator=(const CLHLock& other) = delete;
+    ~CLHLock() {
+        delete tail.load(std::memory_order_relaxed);
+    }
+
+    void lock() {
+        CLHLockNode* my_node = QueueNodePool<CLHLockNode>::get();
+        my_node->locked.store(true, std::memory_order_relaxed);
+
+        CLHLockNode* pred = tail.exchange(my_node, std::memory_order_acq_rel);
+        while (pred->locked.load(std::memory_order_acquire)) {
+            /* keep spinning until predecessor unlocks */
+            cpu_relax();
+        }
+        holder = my_node;
+        holder_pred = pred;
+    }
+
+    void unlock() {
+        CLHLockNode* pred = holder_pred;
+        holder->locked.store(false, std::memory_order_release);
+        /* nobody references the predecessor's node any more */
+        QueueNodePool<CLHLockNode>::put(pred);
+    }
+};
+
+class MCSLock {
+    struct MCSLockNode {
+        std::atomic<MCSLockNode*> next{nullptr};
+        std::atomic<bool> locked{false};
+    };
+
+    std::atomic<MCSLockNode*> tail{nullptr}; // Tail of the queue
+    MCSLockNode* holder = nullptr; // node of the current lock holder
+
+public:
+    void lock() {
+        MCSLockNode* my_node = QueueNodeStack<MCSLockNode>::get();
+        my_node->next.store(nullptr, std::memory_order_relaxed);
+        my_node->locked.store(true, std::memory_order_relaxed);
+
+        MCSLockNode* pred = tail.exchange(my_node, std::memory_order_acq_rel);
+
+        if (pred != nullptr) {
+            pred->next.store(my_node, std::memory_order_release);
+
+            while (my_node->locked.load(std::memory_order_acquire)) {
+                /* keep spinning until predecessor unlocks us */
+                cpu_relax();
+            }
+        }
+        holder = my_node;
+    }
+
+    void unlock() {
+        MCSLockNode* my_node = holder;
+        MCSLockNode* next_node = my_node->next.load(std::memory_order_acquire);
+
+        if (next_node == nullptr) {
+            MCSLockNode* expected = my_node;
+            if (!tail.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel)) {
+                while (next_node == nullptr) {
+                    /* wait until the next pointer is updated by the successor */
+                    next_node = my_node->next.load(std::memory_order_acquire);
+                }
+                next_node->locked.store(false, std::memory_order_release);
+            }
+        } else {
+            next_node->locked.store(false, std::memory_order_release);
+        }
+
+        /* nobody references my_node any more: give it back */
+        QueueNodeStack<MCSLockNode>::put(my_node);
+    }
+};
+
+/* cohort lock built from ticket locks (C-TKT-TKT)
+ * threads first take the local lock of their cluster, the first of a
+ * cohort then takes the global lock; on unlock the global lock is passed
+ * on inside the cluster while it has waiters, up to MAX_PASSES times in a
+ * row, so the list mostly stays in the caches of one cluster
+ * clusters stand in for NUMA nodes: the processors are split into
+ * CLUSTERS contiguous ranges by the number returned from sched_getcpu()
+ */
+template<std::size_t CLUSTERS = 2, unsigned MAX_PASSES = 64>
+class CohortLock {
+    struct alignas(64) Cluster {
+        TicketLock local;
+        /* only accessed by the holder of local */
+        bool global_held = false;
+        unsigned passes = 0;
+    };
+
+    /* must be thread-oblivious: released by whoever ends the cohort */
+    alignas(64) TicketLock global;
+    Cluster clusters[CLUSTERS];
+    std::size_t holder = 0; // cluster of the current lock holder
+
+    static std::size_t current_cluster() {
+        static const unsigned cpus = std::thread::hardware_concurrency();
+        int cpu = sched_getcpu();
+        if (cpu < 0 || cpus == 0) {
+            return 0;
+        }
+        std::size_t per_cluster = (cpus + CLUSTERS - 1) / CLUSTERS;
+        std::size_t c = static_cast<std::size_t>(cpu) / per_cluster;
+        return c < CLUSTERS ? c : CLUSTERS - 1;
+    }
+
+public:
+    void lock() {
+        std::size_t c = current_cluster();
+        Cluster& cl = clusters[c];
+        cl.local.lock();
+        if (!cl.global_held) {
+            global.lock();
+            cl.global_held = true;
+            cl.passes = 0;
+        }
+        holder = c;
+    }
+
+    void unlock() {
+        Cluster& cl = clusters[holder];
+        if (cl.local.has_waiters() && ++cl.passes < MAX_PASSES) {
+            /* the next local thread inherits the global lock */
+            cl.local.unlock();
+            return;
+        }
+        cl.global_held = false;
+        global.unlock();
+        cl.local.unlock();
+    }
+};
+
+/* three-state futex mutex (Drepper, "Futexes Are Tricky") that first
+ * spins like BackoffLock
+ * state 0: free, 1: locked, 2: locked and threads may be sleeping
+ */
+class AdaptiveLock {
+    /* backoff rounds before sleeping, the delay doubles up to MAX_DELAY */
+    static const unsigned SPIN_LIMIT = 16;
+    static const unsigned MIN_DELAY = 4;
+    static const unsigned MAX_DELAY = 256;
+
+    std::atomic<int> state{0};
+
+public:
+    void lock() {
+        unsigned delay = MIN_DELAY;
+        for (unsigned round = 0; round < SPIN_LIMIT; round++) {
+            int c = state.load(std::memory_order_relaxed);
+            if (c == 0 && state.compare_exchange_weak(c, 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+                return;
+            }
+            if (c == 2) {
+                /* others are already sleeping, spinning is unlikely to help */
+                break;
+            }
+            for (unsigned i = 0; i < delay; i++) {
+                cpu_relax();
+            }
+            delay = delay < MAX_DELAY ? 2 * delay : MAX_DELAY;
+        }
+        /* announce a sleeper; whoever gets the lock from here keeps state 2,
+         * so its unlock() wakes the next sleeper
+         */
+        while (state.exchange(2, std::memory_order_acquire) != 0) {
+            futex_wait(&state, 2);
+        }
+    }
+
+    void unlock() {
+        if (state.exchange(0, std::memory_order_release) == 2) {
+            futex_wake(&state, 1);
+        }
+    }
+};
+
+/* MCS lock whose waiters spin on their own node for SPIN_LIMIT rounds and
+ * then sleep on it; FIFO order is kept, only the handoff to a sleeping
+ * successor costs a system call
+ */
+class AdaptiveMCSLock {
+    static const unsigned SPIN_LIMIT = 1024;
+    enum { FREE = 0, LOCKED = 1, SLEEPING = 2 };
+
+    struct AdaptiveMCSLockNode {
+        std::atomic<AdaptiveMCSLockNode*> next{nullptr};
+        std::atomic<int> locked{FREE};
+    };
+
+    std::atomic<AdaptiveMCSLockNode*> tail{nullptr}; // Tail of the queue
+    AdaptiveMCSLockNode* holder = nullptr; // node of the current lock holder
+
+    static void wait(AdaptiveMCSLockNode* my_node) {
+        for (unsigned i = 0; i < SPIN_LIMIT; i++) {
+            if (my_node->locked.load(std::memory_order_acquire) == FREE) {
+                return;
+            }
+            cpu_relax();
+        }
+        int expected = LOCKED;
+        if (!my_node->locked.compare_exchange_strong(expected, SLEEPING, std::memory_order_acquire)) {
+            /* FREE already */
+            return;
+        }
+        while (my_node->locked.load(std::memory_order_acquire) != FREE) {
+            futex_wait(&my_node->locked, SLEEPING);
+        }
+    }
+
+    /* the woken thread may already have reused its node: a stray wake-up
+     * only makes some waiter re-check its word, which every wait does
+     */
+    static void wake(AdaptiveMCSLockNode* node) {
+        if (node->locked.exchange(FREE, std::memory_order_release) == SLEEPING) {
+            futex_wake(&node->locked, 1);
+        }
+    }
+
+public:
+    void lock() {
+        AdaptiveMCSLockNode* my_node = QueueNodeStack<AdaptiveMCSLockNode>::get();
+        my_node->next.store(nullptr, std::memory_order_relaxed);
+        my_node->locked.store(LOCKED, std::memory_order_relaxed);
+
+        AdaptiveMCSLockNode* pred = tail.exchange(my_node, std::memory_order_acq_rel);
+
+        if (pred != nullptr) {
+            pred->next.store(my_node, std::memory_order_release);
+            wait(my_node);
+        }
+        holder = my_node;
+    }
+
+    void unlock() {
+        AdaptiveMCSLockNode* my_node = holder;
+        AdaptiveMCSLockNode* next_node = my_node->next.load(std::memory_order_acquire);
+
+        if (next_node == nullptr) {
+            AdaptiveMCSLockNode* expected = my_node;
+            if (tail.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel)) {
+                QueueNodeStack<AdaptiveMCSLockNode>::put(my_node);
+                return;
+            }
+            while (next_node == nullptr) {
+                /* the successor is between its exchange and setting next */
+                std::this_thread::yield();
+                next_node = my_node->next.load(std::memory_order_acquire);
+            }
+        }
+        wake(next_node);
+
+        /* nobody references my_node any more: give it back */
+        QueueNodeStack<AdaptiveMCSLockNode>::put(my_node);
+    }
+};
+
+/* like default_layout in node_layout.hpp: Fallback unless overridden */
+#ifdef LIST_LOCK
+template<typename Fallback>
+using default_lock = profiled_lock<LIST_LOCK>;
+#else
+template<typename Fallback>
+using default_lock = profiled_lock<Fallback>;
+#endif
+
+#endif // lacpp_locks_hpp
@@ -0,0 +1,146 @@
+#ifndef lacpp_node_layout_hpp
+#define lacpp_node_layout_hpp lacpp_node_layout_hpp
+
+/* memory layouts for the nodes of the fine-grained sorted lists
+ *
+ * A layout policy is instantiated with the lock type and provides:
+ *   node<T>            the list node, with member value and the atomic
+ *                      members next, marked and version of
+ *                      node_version.hpp
+ *   lock(n), unlock(n) the lock protecting node n
+ *   same_lock(a, b)    true if a and b are protected by the same lock;
+ *                      hand-over-hand locking must not take it twice
+ *
+ * packed_layout   lock inside the node, nodes as small as possible
+ * padded_layout   lock inside the node, every node on its own cache line
+ * striped_layout  no lock in the node, locks live in a padded table
+ *
+ * Compiling with -DLIST_NODE_PADDED or -DLIST_NODE_STRIPED changes the
+ * default layout.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/* value, lock and next packed together: neighbours share cache lines */
+template<typename Lock>
+struct packed_layout {
+	template<typename T>
+	struct node {
+		T value;
+		Lock lock;
+		std::atomic<node<T>*> next{nullptr};
+		std::atomic<bool> marked{false};
+		std::atomic<std::uint64_t> version{0};
+	};
+
+	template<typename T>
+	static void lock(node<T>* n) {
+		n->lock.lock();
+	}
+
+	template<typename T>
+	static void unlock(node<T>* n) {
+		n->lock.unlock();
+	}
+
+	template<typename T>
+	static bool same_lock(node<T>* a, node<T>* b) {
+		return a == b;
+	}
+};
+
+/* like packed, but a node never shares its cache line with another one */
+template<typename Lock>
+struct padded_layout {
+	template<typename T>
+	struct alignas(64) node {
+		T value;
+		Lock lock;
+		std::atomic<node<T>*> next{nullptr};
+		std::atomic<bool> marked{false};
+		std::atomic<std::uint64_t> version{0};
+	};
+
+	template<typename T>
+	static void lock(node<T>* n) {
+		n->lock.lock();
+	}
+
+	template<typename T>
+	static void unlock(node<T>* n) {
+		n->lock.unlock();
+	}
+
+	template<typename T>
+	static bool same_lock(node<T>* a, node<T>* b) {
+		return a == b;
+	}
+};
+
+/* locks in a table of STRIPES cache-line padded locks
+ * nodes hold no lock, so traversals read densely packed nodes and
+ * lock traffic stays in the table
+ * a node's lock is chosen by value/WIDTH, clamped to the table, rather
+ * than by a hash: it never decreases along the list, so hand-over-hand
+ * locking still takes locks in one global order and cannot deadlock
+ * T must be convertible to long, and a list's head sentinel (value T())
+ * must map to stripe 0
+ */
+template<typename Lock, std::size_t STRIPES = 4096, long WIDTH = 4>
+struct striped_layout {
+	template<typename T>
+	struct node {
+		T value;
+		std::atomic<node<T>*> next{nullptr};
+		std::atomic<bool> marked{false};
+		std::atomic<std::uint64_t> version{0};
+	};
+
+	struct alignas(64) stripe {
+		Lock lock;
+	};
+
+	static stripe* table() {
+		static stripe locks[STRIPES];
+		return locks;
+	}
+
+	template<typename T>
+	static std::size_t index(node<T>* n) {
+		long i = static_cast<long>(n->value) / WIDTH;
+		if(i < 0) {
+			return 0;
+		}
+		return static_cast<std::size_t>(i) < STRIPES ? static_cast<std::size_t>(i) : STRIPES - 1;
+	}
+
+	template<typename T>
+	static void lock(node<T>* n) {
+		table()[index(n)].lock.lock();
+	}
+
+	template<typename T>
+	static void unlock(node<T>* n) {
+		table()[index(n)].lock.unlock();
+	}
+
+	template<typename T>
+	static bool same_lock(node<T>* a, node<T>* b) {
+		return index(a) == index(b);
+	}
+};
+
+#if defined(LIST_NODE_PADDED)
+template<typename Lock>
+using default_layout = padded_layout<Lock>;
+#elif defined(LIST_NODE_STRIPED)
+template<typename Lock>
+using default_layout = striped_layout<Lock>;
+#else
+template<typename Lock>
+using default_layout = packed_layout<Lock>;
+#endif
+
+#endif // lacpp_node_layout_hpp
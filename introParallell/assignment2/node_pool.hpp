@@ -0,0 +1,245 @@
+#ifndef lacpp_node_pool_hpp
+#define lacpp_node_pool_hpp lacpp_node_pool_hpp
+
+/* node allocators for the sorted lists
+ *
+ * Every list takes an allocator policy as template parameter and creates
+ * and destroys its nodes only through it:
+ *   create<N>(args...)  construct a new N
+ *   destroy<N>(p)       destruct and free the N at p; takes void* so it can
+ *                       also be handed to retire() of a reclamation policy
+ *
+ * new_allocator uses plain new/delete. pool_allocator keeps a per-thread
+ * free list for every block size and refills it in batches from a shared
+ * arena of cache-line aligned slabs, so the global allocator is only
+ * called once per slab. Slab memory is never returned to the system.
+ *
+ * Compiling with -DLIST_NODE_POOL makes pool_allocator the default.
+ */
+
+#include <cstddef>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/* plain new and delete
+ * before C++17 new ignores alignment beyond max_align_t, so over-aligned
+ * nodes (see padded_layout in node_layout.hpp) use posix_memalign instead
+ */
+class new_allocator {
+	template<typename N>
+	struct over_aligned : std::integral_constant<bool, (alignof(N) > alignof(std::max_align_t))> {};
+
+	template<typename N, typename... Args>
+	static N* create_impl(std::false_type, Args&&... args) {
+		return new N(std::forward<Args>(args)...);
+	}
+
+	template<typename N, typename... Args>
+	static N* create_impl(std::true_type, Args&&... args) {
+		void* p = nullptr;
+		if(posix_memalign(&p, alignof(N), sizeof(N)) != 0) {
+			throw std::bad_alloc();
+		}
+		return new(p) N(std::forward<Args>(args)...);
+	}
+
+	template<typename N>
+	static void destroy_impl(std::false_type, void* p) {
+		delete static_cast<N*>(p);
+	}
+
+	template<typename N>
+	static void destroy_impl(std::true_type, void* p) {
+		static_cast<N*>(p)->~N();
+		std::free(p);
+	}
+
+	public:
+		template<typename N, typename... Args>
+		static N* create(Args&&... args) {
+			return create_impl<N>(over_aligned<N>(), std::forward<Args>(args)...);
+		}
+
+		template<typename N>
+		static void destroy(void* p) {
+			destroy_impl<N>(over_aligned<N>(), p);
+		}
+};
+
+namespace node_pool_detail {
+	static const std::size_t CACHE_LINE = 64;
+	static const std::size_t SLAB_SIZE = 1 << 16;
+	/* blocks moved between a thread and the arena at a time */
+	static const std::size_t BATCH = 64;
+
+	/* a free block, the first block of a batch also links the next batch */
+	struct free_block {
+		free_block* next;
+		free_block* next_batch;
+	};
+
+	/* shared pool of free blocks of one size */
+	template<std::size_t BlockSize>
+	class arena {
+		std::mutex lock;
+		free_block* batches = nullptr;
+		char* bump = nullptr;
+		char* bump_end = nullptr;
+
+		public:
+			/* never destroyed: nodes may outlive every static object */
+			static arena& instance() {
+				static arena* a = new arena();
+				return *a;
+			}
+
+			/* a nullptr terminated list of free blocks */
+			free_block* get_batch() {
+				std::lock_guard<std::mutex> guard(lock);
+				if(batches != nullptr) {
+					free_block* b = batches;
+					batches = b->next_batch;
+					return b;
+				}
+				if(static_cast<std::size_t>(bump_end - bump) < BATCH * BlockSize) {
+					std::size_t size = SLAB_SIZE > BATCH * BlockSize ? SLAB_SIZE : BATCH * BlockSize;
+					/* over-allocate to align the slab to a cache line */
+					char* raw = static_cast<char*>(::operator new(size + CACHE_LINE));
+					bump = raw + (CACHE_LINE - reinterpret_cast<std::size_t>(raw) % CACHE_LINE);
+					bump_end = bump + size;
+				}
+				free_block* head = nullptr;
+				for(std::size_t i = 0; i < BATCH; i++) {
+					free_block* b = reinterpret_cast<free_block*>(bump_end - (i + 1) * BlockSize);
+					b->next = head;
+					head = b;
+				}
+				bump_end -= BATCH * BlockSize;
+				return head;
+			}
+
+			void put_batch(free_block* b) {
+				std::lock_guard<std::mutex> guard(lock);
+				b->next_batch = batches;
+				batches = b;
+			}
+	};
+
+	/* per-thread free list
+	 * trivially destructible, so it stays usable while other thread_local
+	 * objects (e.g. reclamation records) free nodes during thread exit
+	 */
+	struct thread_cache {
+		free_block* free;
+		std::size_t count;
+		bool exited;
+	};
+
+	template<std::size_t BlockSize>
+	class pool {
+		/* hands the free list back to the arena when the thread exits */
+		struct flusher {
+			~flusher() {
+				thread_cache& c = cache();
+				if(c.free != nullptr) {
+					arena<BlockSize>::instance().put_batch(c.free);
+				}
+				c.free = nullptr;
+				c.count = 0;
+				c.exited = true;
+			}
+		};
+
+		static thread_cache& cache() {
+			thread_local thread_cache c = {nullptr, 0, false};
+			return c;
+		}
+
+		public:
+			static void* allocate() {
+				thread_cache& c = cache();
+				if(c.free == nullptr) {
+					if(c.exited) {
+						/* too late to cache: a single block from the arena */
+						free_block* b = arena<BlockSize>::instance().get_batch();
+						if(b->next != nullptr) {
+							arena<BlockSize>::instance().put_batch(b->next);
+						}
+						return b;
+					}
+					thread_local flusher f;
+					(void) f;
+					c.free = arena<BlockSize>::instance().get_batch();
+					c.count = 0;
+					for(free_block* b = c.free; b != nullptr; b = b->next) {
+						c.count++;
+					}
+				}
+				free_block* b = c.free;
+				c.free = b->next;
+				c.count--;
+				return b;
+			}
+
+			static void deallocate(void* p) {
+				thread_cache& c = cache();
+				free_block* b = static_cast<free_block*>(p);
+				if(c.exited) {
+					b->next = nullptr;
+					arena<BlockSize>::instance().put_batch(b);
+					return;
+				}
+				b->next = c.free;
+				c.free = b;
+				c.count++;
+				if(c.count >= 2 * BATCH) {
+					/* keep the BATCH most recently freed, cache-hot blocks
+					 * at the head and give the older rest back to the arena
+					 */
+					free_block* last = c.free;
+					for(std::size_t i = 1; i < BATCH; i++) {
+						last = last->next;
+					}
+					free_block* rest = last->next;
+					last->next = nullptr;
+					arena<BlockSize>::instance().put_batch(rest);
+					c.count -= BATCH;
+				}
+			}
+	};
+
+	/* sizeof(N) rounded up so every block is aligned for N and a free_block */
+	template<typename N>
+	struct block_size {
+		static const std::size_t align = alignof(N) > alignof(free_block) ? alignof(N) : alignof(free_block);
+		static const std::size_t raw = sizeof(N) > sizeof(free_block) ? sizeof(N) : sizeof(free_block);
+		static const std::size_t value = (raw + align - 1) / align * align;
+	};
+}
+
+class pool_allocator {
+	public:
+		template<typename N, typename... Args>
+		static N* create(Args&&... args) {
+			static_assert(alignof(N) <= node_pool_detail::CACHE_LINE, "blocks are at most cache line aligned");
+			void* p = node_pool_detail::pool<node_pool_detail::block_size<N>::value>::allocate();
+			return new(p) N(std::forward<Args>(args)...);
+		}
+
+		template<typename N>
+		static void destroy(void* p) {
+			static_cast<N*>(p)->~N();
+			node_pool_detail::pool<node_pool_detail::block_size<N>::value>::deallocate(p);
+		}
+};
+
+#ifdef LIST_NODE_POOL
+typedef pool_allocator default_allocator;
+#else
+typedef new_allocator default_allocator;
+#endif
+
+#endif // lacpp_node_pool_hpp
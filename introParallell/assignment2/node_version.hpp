@@ -0,0 +1,102 @@
+#ifndef lacpp_node_version_hpp
+#define lacpp_node_version_hpp lacpp_node_version_hpp
+
+/* range scans that do not lock, for lists with versioned nodes
+ *
+ * A node type N has the atomic members next, marked and version. The
+ * holder of a node's lock changes its next or marked only through
+ * versioned(), which keeps version odd during the change and advances it
+ * by two. Removal marks a node before it unlinks it, and unlinked nodes
+ * are retired through a reclamation policy (reclamation.hpp), so a scan
+ * inside a guard may still walk them.
+ *
+ * scan() collects the nodes from the last node < lo up to the first node
+ * > hi twice. Two collections that saw the same versions of the same
+ * nodes saw the same next and marked fields: nothing changed in between,
+ * and at any instant between them the unmarked start node was in the list
+ * and these nodes followed it. Updates never wait for a scan; a scan
+ * retries while updates keep changing its part of the list.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+template<typename N>
+struct node_versions {
+	/* with n locked: apply change to n's next or marked as a new version */
+	template<typename Change>
+	static void versioned(N* n, Change change) {
+		std::uint64_t v = n->version.load(std::memory_order_relaxed);
+		n->version.store(v + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		change();
+		n->version.store(v + 2, std::memory_order_release);
+	}
+
+	/* next and marked of n as of one version, false while n changes */
+	static bool read_version(N* n, std::uint64_t& version, N*& next, bool& marked) {
+		version = n->version.load(std::memory_order_acquire);
+		next = n->next.load(std::memory_order_acquire);
+		marked = n->marked.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return (version & 1) == 0 && n->version.load(std::memory_order_relaxed) == version;
+	}
+
+	/* a node as a scan saw it */
+	struct seen_node {
+		N* n;
+		std::uint64_t version;
+		bool marked;
+
+		bool operator==(const seen_node& other) const {
+			return n == other.n && version == other.version;
+		}
+	};
+
+	/* the nodes from the unmarked from up to the first node > hi, with
+	 * their versions; false if one of them was changing
+	 */
+	template<typename T>
+	static bool collect(N* from, const T& hi, std::vector<seen_node>& seen) {
+		seen.clear();
+		N* n = from;
+		while(true) {
+			std::uint64_t version;
+			N* next;
+			bool marked;
+			if(!read_version(n, version, next, marked) || (n == from && marked)) {
+				return false;
+			}
+			seen.push_back({n, version, marked});
+			if(next == nullptr || hi < next->value) {
+				return true;
+			}
+			n = next;
+		}
+	}
+
+	/* the nodes v with lo <= v <= hi at one instant, marked ones included
+	 * find() returns the last node < lo without locking, or the head
+	 */
+	template<typename T, typename Find>
+	static std::vector<seen_node> scan(const T& lo, const T& hi, Find find) {
+		std::vector<seen_node> first;
+		std::vector<seen_node> second;
+		while(true) {
+			N* pred = find();
+			if(collect(pred, hi, first) && collect(pred, hi, second) && first == second) {
+				/* drop the start node, it is < lo or the head, and the
+				 * nodes < lo inserted after it since find()
+				 */
+				auto begin = first.begin() + 1;
+				while(begin != first.end() && begin->n->value < lo) {
+					++begin;
+				}
+				return std::vector<seen_node>(begin, first.end());
+			}
+		}
+	}
+};
+
+#endif // lacpp_node_version_hpp
@@ -0,0 +1,175 @@
+#ifndef lacpp_sorted_list_mutexlock_optimistic_hpp
+#define lacpp_sorted_list_mutexlock_optimistic_hpp lacpp_sorted_list_mutexlock_optimistic_hpp
+
+/* an optimistically synchronized sorted list based on the sorted list
+ * implementation by David Klaftenegger, 2015
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+
+#include "locks.hpp"
+#include "node_pool.hpp"
+#include "reclamation.hpp"
+
+/* struct for list nodes
+ * next is atomic as it is read without holding the lock
+ */
+template<typename T, typename Lock>
+struct node {
+	T value;
+	Lock lock;
+	std::atomic<node<T, Lock>*> next{nullptr};
+};
+
+/* concurrent sorted singly-linked list using optimistic synchronization
+ * positions are searched without locks, then pred and current are locked
+ * and validate() checks that pred is still reachable and links to current
+ * unlinked nodes may still be traversed, Reclaim defers freeing them
+ */
+template<typename T, typename Lock = default_lock<std::mutex>, typename Reclaim = epoch_reclamation, typename Alloc = default_allocator>
+class sorted_list {
+	template<typename U>
+	using node = ::node<U, Lock>;
+
+	typedef typename Reclaim::guard guard;
+	/* sentinel: its lock guards the link to the first element */
+	node<T> head;
+
+	/* find the last node with value < v and its successor without locking */
+	void find(T v, node<T>*& pred, node<T>*& current) {
+		pred = &head;
+		current = head.next.load(std::memory_order_acquire);
+		while(current != nullptr && current->value < v) {
+			pred = current;
+			current = current->next.load(std::memory_order_acquire);
+		}
+	}
+
+	/* with pred locked: is pred still in the list and followed by current? */
+	bool validate(node<T>* pred, node<T>* current) {
+		node<T>* n = &head;
+		while(n != nullptr) {
+			if(n == pred) {
+				return pred->next.load(std::memory_order_acquire) == current;
+			}
+			if(n != &head && pred != &head && pred->value < n->value) {
+				/* passed the place where pred would have to be */
+				return false;
+			}
+			n = n->next.load(std::memory_order_acquire);
+		}
+		return false;
+	}
+
+	/* lock pred and current (if any) and validate the pair
+	 * returns with both locked on success and nothing locked on failure
+	 */
+	bool lock_and_validate(node<T>* pred, node<T>* current) {
+		pred->lock.lock();
+		(current != nullptr) ? current->lock.lock() : void();
+		if(validate(pred, current)) {
+			return true;
+		}
+		(current != nullptr) ? current->lock.unlock() : void();
+		pred->lock.unlock();
+		return false;
+	}
+
+	public:
+		/* default constructor only:
+		 * copying or moving a list would race with concurrent users
+		 */
+		sorted_list() = default;
+		sorted_list(const sorted_list<T, Lock, Reclaim, Alloc>& other) = delete;
+		sorted_list(sorted_list<T, Lock, Reclaim, Alloc>&& other) = delete;
+		sorted_list<T, Lock, Reclaim, Alloc>& operator=(const sorted_list<T, Lock, Reclaim, Alloc>& other) = delete;
+		sorted_list<T, Lock, Reclaim, Alloc>& operator=(sorted_list<T, Lock, Reclaim, Alloc>&& other) = delete;
+		~sorted_list() {
+			node<T>* current = head.next.load(std::memory_order_relaxed);
+			while(current != nullptr) {
+				node<T>* next = current->next.load(std::memory_order_relaxed);
+				Alloc::template destroy<node<T>>(current);
+				current = next;
+			}
+		}
+
+		/* insert v into the list */
+		void insert(T v) {
+			/* construct new node */
+			node<T>* newNode = Alloc::template create<node<T>>();
+			newNode->value = v;
+
+			guard g;
+			node<T>* pred;
+			node<T>* current;
+			while(true) {
+				/* first find position */
+				find(v, pred, current);
+				if(!lock_and_validate(pred, current)) {
+					continue;
+				}
+				/* insert new node between pred and current */
+				newNode->next.store(current, std::memory_order_relaxed);
+				pred->next.store(newNode, std::memory_order_release);
+				(current != nullptr) ? current->lock.unlock() : void();
+				pred->lock.unlock();
+				return;
+			}
+		}
+
+		void remove(T v) {
+			guard g;
+			node<T>* pred;
+			node<T>* current;
+			while(true) {
+				/* first find position */
+				find(v, pred, current);
+				if(!lock_and_validate(pred, current)) {
+					continue;
+				}
+				if(current == nullptr || current->value != v) {
+					/* v not found */
+					(current != nullptr) ? current->lock.unlock() : void();
+					pred->lock.unlock();
+					return;
+				}
+				/* remove current */
+				pred->next.store(current->next.load(std::memory_order_relaxed), std::memory_order_release);
+				current->lock.unlock();
+				pred->lock.unlock();
+				Reclaim::retire(current, &Alloc::template destroy<node<T>>);
+				return;
+			}
+		}
+
+		/* count elements with value v in the list
+		 * only the run of nodes with value v is locked hand-over-hand
+		 */
+		std::size_t count(T v) {
+			guard g;
+			node<T>* pred;
+			node<T>* current;
+			do {
+				/* first go to value v */
+				find(v, pred, current);
+			} while(!lock_and_validate(pred, current));
+
+			/* count elements */
+			std::size_t cnt = 0;
+			while(current != nullptr && current->value == v) {
+				cnt++;
+				pred->lock.unlock();
+				pred = current;
+				current = current->next.load(std::memory_order_acquire);
+				(current != nullptr) ? current->lock.lock() : void();
+			}
+
+			(current != nullptr) ? current->lock.unlock() : void();
+			pred->lock.unlock();
+			return cnt;
+		}
+};
+
+#endif // lacpp_sorted_list_mutexlock_optimistic_hpp
@@ -0,0 +1,161 @@
+#ifndef lacpp_perf_counters_hpp
+#define lacpp_perf_counters_hpp lacpp_perf_counters_hpp
+
+/* hardware performance counters for the measured part of a benchmark
+ *
+ * Every worker opens the events in PERF_EVENTS for itself with
+ * perf_event_open, user space only so perf_event_paranoid 2 is enough,
+ * enables them when it starts measuring and disables them when it stops.
+ * Each event is opened on its own, so the kernel multiplexes them when
+ * there are more events than counters; the counts are scaled by time
+ * enabled / time running. An event that cannot be opened (no PMU in a
+ * VM, a stricter paranoid setting, a raw event the cpu does not know)
+ * is reported as unavailable and the benchmark runs as before.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+struct perf_event_spec {
+	std::string name;
+	std::uint32_t type;
+	std::uint64_t config;
+};
+
+/* events counted by every worker, empty for none */
+static std::vector<perf_event_spec> PERF_EVENTS;
+
+namespace perf_detail {
+	static inline std::uint64_t cache_event(std::uint64_t cache, std::uint64_t op, std::uint64_t result) {
+		return cache | (op << 8) | (result << 16);
+	}
+
+	static inline bool named_event(const std::string& name, perf_event_spec& e) {
+		static const perf_event_spec known[] = {
+			{"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+			{"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+			{"cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+			{"branch-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+			{"l1d-misses", PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+			{"llc-misses", PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)},
+			/* kernel counted, also without a PMU */
+			{"context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+			{"page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+		};
+		for(auto& k : known) {
+			if(k.name == name) {
+				e = k;
+				return true;
+			}
+		}
+		/* raw event rUUEE as with perf stat */
+		if(name.size() > 1 && name[0] == 'r') {
+			std::istringstream in(name.substr(1));
+			std::uint64_t config;
+			if((in >> std::hex >> config) && in.eof()) {
+				e = {name, PERF_TYPE_RAW, config};
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+/* parse a comma separated list of events:
+ *   cycles, instructions, cache-misses, branch-misses, l1d-misses,
+ *   llc-misses, context-switches, page-faults, or raw events rUUEE
+ *   (umask, event number in hex) as with perf stat; cache lines taken
+ *   from another core's modified copy (HITM) have no generic event, on
+ *   Skylake they are r04d2 (MEM_LOAD_L3_HIT_RETIRED.XSNP_HITM)
+ * default stands for instructions,cycles,cache-misses,branch-misses
+ */
+static inline bool parse_perf_events(const std::string& list, std::vector<perf_event_spec>& events) {
+	std::istringstream in(list == "default" ? std::string("instructions,cycles,cache-misses,branch-misses") : list);
+	std::string name;
+	events.clear();
+	while(std::getline(in, name, ',')) {
+		perf_event_spec e;
+		if(!perf_detail::named_event(name, e)) {
+			return false;
+		}
+		events.push_back(e);
+	}
+	return !events.empty();
+}
+
+/* the events of the calling thread */
+class perf_counters {
+	std::vector<int> fds;
+
+	public:
+		explicit perf_counters(const std::vector<perf_event_spec>& events) {
+			for(auto& e : events) {
+				perf_event_attr attr;
+				std::memset(&attr, 0, sizeof(attr));
+				attr.size = sizeof(attr);
+				attr.type = e.type;
+				attr.config = e.config;
+				attr.disabled = 1;
+				/* software events happen in the kernel */
+				attr.exclude_kernel = e.type != PERF_TYPE_SOFTWARE;
+				attr.exclude_hv = 1;
+				attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+				/* this thread, any cpu */
+				fds.push_back(static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0)));
+			}
+		}
+
+		perf_counters(const perf_counters&) = delete;
+		perf_counters& operator=(const perf_counters&) = delete;
+
+		~perf_counters() {
+			for(int fd : fds) {
+				if(fd >= 0) {
+					close(fd);
+				}
+			}
+		}
+
+		void start() {
+			for(int fd : fds) {
+				if(fd >= 0) {
+					ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+					ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+				}
+			}
+		}
+
+		void stop() {
+			for(int fd : fds) {
+				if(fd >= 0) {
+					ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+				}
+			}
+		}
+
+		/* scaled counts since start(), NaN for unavailable events */
+		std::vector<double> read() const {
+			std::vector<double> counts;
+			for(int fd : fds) {
+				/* value, time enabled, time running */
+				std::uint64_t v[3];
+				if(fd < 0 || ::read(fd, v, sizeof(v)) != sizeof(v) || v[2] == 0) {
+					counts.push_back(std::nan(""));
+				} else {
+					counts.push_back(static_cast<double>(v[0]) * v[1] / v[2]);
+				}
+			}
+			return counts;
+		}
+};
+
+#endif // lacpp_perf_counters_hpp
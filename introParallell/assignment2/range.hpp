@@ -0,0 +1,71 @@
+#ifndef lacpp_range_hpp
+#define lacpp_range_hpp lacpp_range_hpp
+
+/* range queries on any sorted list variant
+ *
+ * range_count(l, lo, hi)  number of elements v with lo <= v <= hi
+ * snapshot(l)             all elements in ascending order
+ *
+ * Lists that provide these operations as members answer them from one
+ * consistent view of the list: the coarse-grained lists under their lock,
+ * the fine-grained and the lazy lists from versioned nodes without
+ * blocking updates (see node_version.hpp). For all other lists
+ * range_count falls back to one count() per key, which is not atomic, and
+ * snapshot() is not available; atomic_range_count<List, T>() tells the
+ * two cases apart.
+ */
+
+#include <cstddef>
+#include <utility>
+
+namespace range_detail {
+	/* the int overloads are preferred and only exist if l has the member */
+	template<typename List, typename T>
+	auto range_count(List& l, T lo, T hi, int) -> decltype(l.range_count(lo, hi)) {
+		return l.range_count(lo, hi);
+	}
+
+	template<typename List, typename T>
+	std::size_t range_count(List& l, T lo, T hi, long) {
+		if(hi < lo) {
+			return 0;
+		}
+		std::size_t cnt = 0;
+		/* stops at hi itself, which may be the largest T */
+		for(T v = lo; ; v++) {
+			cnt += l.count(v);
+			if(v == hi) {
+				break;
+			}
+		}
+		return cnt;
+	}
+
+	template<typename List, typename T>
+	constexpr auto atomic_range_count(int) -> decltype(std::declval<List&>().range_count(std::declval<T>(), std::declval<T>()), bool()) {
+		return true;
+	}
+
+	template<typename List, typename T>
+	constexpr bool atomic_range_count(long) {
+		return false;
+	}
+}
+
+/* true if range_count on a List is one atomic operation */
+template<typename List, typename T>
+constexpr bool atomic_range_count() {
+	return range_detail::atomic_range_count<List, T>(0);
+}
+
+template<typename List, typename T>
+std::size_t range_count(List& l, T lo, T hi) {
+	return range_detail::range_count(l, lo, hi, 0);
+}
+
+template<typename List>
+auto snapshot(List& l) -> decltype(l.snapshot()) {
+	return l.snapshot();
+}
+
+#endif // lacpp_range_hpp
@@ -0,0 +1,328 @@
+#ifndef lacpp_reclamation_hpp
+#define lacpp_reclamation_hpp lacpp_reclamation_hpp
+
+/* safe memory reclamation for the concurrent sorted lists
+ *
+ * A node that has been unlinked from a list may still be read by threads
+ * that found it before the unlink. Instead of calling delete right away,
+ * lists hand such nodes to retire() of a reclamation policy, which frees
+ * them once no thread can hold a reference any more.
+ *
+ * Every policy provides:
+ *   guard                 RAII object marking a list operation; pointers
+ *                         read from shared memory are only valid while a
+ *                         guard is alive
+ *   guard::protect(i, a)  read the pointer in atomic a and keep its target
+ *                         alive in slot i (0 <= i < guard::slots)
+ *   needs_validation      true if the list must re-check that a protected
+ *                         node is still linked before using it
+ *   retire(p)             delete p once it is safe to do so
+ *   retire(p, deleter)    call deleter(p) instead, e.g. to give the node
+ *                         back to its allocator (see node_pool.hpp)
+ *
+ * Pointers may carry tag bits in their lowest two bits (e.g. deletion
+ * marks), those are ignored when deciding what is protected.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace reclamation_detail {
+	/* a retired pointer together with the function that frees it */
+	struct retired_ptr {
+		void* ptr;
+		void (*deleter)(void*);
+		unsigned long epoch;
+	};
+
+	template<typename N>
+	void delete_node(void* p) {
+		delete static_cast<N*>(p);
+	}
+
+	inline void* strip_tag(void* p) {
+		return reinterpret_cast<void*>(reinterpret_cast<std::uintptr_t>(p) & ~static_cast<std::uintptr_t>(3));
+	}
+
+	/* per-thread records live in a global append-only list and are reused
+	 * by later threads once their owner exited, so they are never freed
+	 */
+	template<typename Record>
+	Record* acquire_record(std::atomic<Record*>& records) {
+		for(Record* r = records.load(std::memory_order_acquire); r != nullptr; r = r->next) {
+			bool expected = false;
+			if(!r->in_use.load(std::memory_order_relaxed) && r->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+				return r;
+			}
+		}
+		Record* r = new Record();
+		r->in_use.store(true, std::memory_order_relaxed);
+		Record* head = records.load(std::memory_order_relaxed);
+		do {
+			r->next = head;
+		} while(!records.compare_exchange_weak(head, r, std::memory_order_release, std::memory_order_relaxed));
+		return r;
+	}
+}
+
+/* nodes are deleted immediately
+ * only correct when locking already excludes concurrent readers
+ */
+class immediate_reclamation {
+	public:
+		class guard {
+			public:
+				static const int slots = 3;
+				template<typename N>
+				N* protect(int, const std::atomic<N*>& src) {
+					return src.load(std::memory_order_acquire);
+				}
+		};
+		static const bool needs_validation = false;
+
+		template<typename N>
+		static void retire(N* p) {
+			delete p;
+		}
+
+		static void retire(void* p, void (*deleter)(void*)) {
+			deleter(p);
+		}
+};
+
+/* epoch-based reclamation
+ *
+ * A thread publishes the global epoch it observed while inside a guard.
+ * The global epoch only advances when every active thread has observed it,
+ * so a node retired in epoch e can be freed once the global epoch reached
+ * e + 2: all threads that might still see it have left their guard.
+ * Retired nodes are kept on a per-thread list, no synchronisation is
+ * needed to retire.
+ */
+class epoch_reclamation {
+	/* collect garbage after this many retirements */
+	static const std::size_t RECLAIM_THRESHOLD = 64;
+
+	struct thread_record {
+		/* (observed epoch << 1) | active */
+		std::atomic<unsigned long> state{0};
+		std::atomic<bool> in_use{false};
+		unsigned int nesting = 0;
+		std::vector<reclamation_detail::retired_ptr> retired;
+		thread_record* next = nullptr;
+	};
+
+	static std::atomic<unsigned long>& global_epoch() {
+		static std::atomic<unsigned long> epoch{0};
+		return epoch;
+	}
+
+	static std::atomic<thread_record*>& records() {
+		static std::atomic<thread_record*> head{nullptr};
+		return head;
+	}
+
+	/* hands the record back when the owning thread exits */
+	struct record_owner {
+		thread_record* record;
+		record_owner() : record(reclamation_detail::acquire_record(records())) {}
+		~record_owner() {
+			try_advance();
+			reclaim(record);
+			record->in_use.store(false, std::memory_order_release);
+		}
+	};
+
+	static thread_record* local_record() {
+		thread_local record_owner owner;
+		return owner.record;
+	}
+
+	/* advance the global epoch if all active threads have observed it */
+	static void try_advance() {
+		unsigned long epoch = global_epoch().load(std::memory_order_seq_cst);
+		for(thread_record* r = records().load(std::memory_order_acquire); r != nullptr; r = r->next) {
+			unsigned long state = r->state.load(std::memory_order_seq_cst);
+			if((state & 1) && (state >> 1) != epoch) {
+				return;
+			}
+		}
+		global_epoch().compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+	}
+
+	/* free everything retired at least two epochs ago */
+	static void reclaim(thread_record* record) {
+		unsigned long epoch = global_epoch().load(std::memory_order_seq_cst);
+		auto& retired = record->retired;
+		std::size_t kept = 0;
+		for(std::size_t i = 0; i < retired.size(); i++) {
+			if(retired[i].epoch + 2 <= epoch) {
+				retired[i].deleter(retired[i].ptr);
+			} else {
+				retired[kept++] = retired[i];
+			}
+		}
+		retired.resize(kept);
+	}
+
+	public:
+		class guard {
+			thread_record* record;
+
+			public:
+				static const int slots = 3;
+
+				guard() : record(local_record()) {
+					if(record->nesting++ == 0) {
+						unsigned long epoch = global_epoch().load(std::memory_order_relaxed);
+						record->state.store((epoch << 1) | 1, std::memory_order_seq_cst);
+					}
+				}
+				guard(const guard&) = delete;
+				guard& operator=(const guard&) = delete;
+				~guard() {
+					if(--record->nesting == 0) {
+						record->state.store(record->state.load(std::memory_order_relaxed) & ~1UL, std::memory_order_release);
+					}
+				}
+
+				template<typename N>
+				N* protect(int, const std::atomic<N*>& src) {
+					return src.load(std::memory_order_acquire);
+				}
+		};
+		static const bool needs_validation = false;
+
+		template<typename N>
+		static void retire(N* p) {
+			retire(p, &reclamation_detail::delete_node<N>);
+		}
+
+		static void retire(void* p, void (*deleter)(void*)) {
+			thread_record* record = local_record();
+			unsigned long epoch = global_epoch().load(std::memory_order_seq_cst);
+			record->retired.push_back({p, deleter, epoch});
+			if(record->retired.size() >= RECLAIM_THRESHOLD) {
+				try_advance();
+				reclaim(record);
+			}
+		}
+};
+
+/* hazard pointer reclamation
+ *
+ * Before dereferencing a shared pointer a thread publishes it in one of its
+ * hazard slots. A retired node is only freed when no slot of any thread
+ * holds it. Unlike epochs, a stalled thread can only keep the nodes it
+ * protects alive, at the price of a store and a re-check per hop.
+ */
+class hazard_reclamation {
+	static const int SLOTS = 3;
+	/* scan hazards after this many retirements */
+	static const std::size_t RECLAIM_THRESHOLD = 128;
+
+	struct thread_record {
+		std::atomic<void*> hazard[SLOTS];
+		std::atomic<bool> in_use{false};
+		std::vector<reclamation_detail::retired_ptr> retired;
+		thread_record* next = nullptr;
+
+		thread_record() {
+			for(auto& h : hazard) {
+				h.store(nullptr, std::memory_order_relaxed);
+			}
+		}
+	};
+
+	static std::atomic<thread_record*>& records() {
+		static std::atomic<thread_record*> head{nullptr};
+		return head;
+	}
+
+	struct record_owner {
+		thread_record* record;
+		record_owner() : record(reclamation_detail::acquire_record(records())) {}
+		~record_owner() {
+			scan(record);
+			record->in_use.store(false, std::memory_order_release);
+		}
+	};
+
+	static thread_record* local_record() {
+		thread_local record_owner owner;
+		return owner.record;
+	}
+
+	/* free all retired nodes not protected by any thread */
+	static void scan(thread_record* record) {
+		std::vector<void*> hazards;
+		for(thread_record* r = records().load(std::memory_order_acquire); r != nullptr; r = r->next) {
+			for(auto& h : r->hazard) {
+				void* p = h.load(std::memory_order_seq_cst);
+				if(p != nullptr) {
+					hazards.push_back(p);
+				}
+			}
+		}
+		std::sort(hazards.begin(), hazards.end());
+		auto& retired = record->retired;
+		std::size_t kept = 0;
+		for(std::size_t i = 0; i < retired.size(); i++) {
+			if(std::binary_search(hazards.begin(), hazards.end(), retired[i].ptr)) {
+				retired[kept++] = retired[i];
+			} else {
+				retired[i].deleter(retired[i].ptr);
+			}
+		}
+		retired.resize(kept);
+	}
+
+	public:
+		class guard {
+			thread_record* record;
+
+			public:
+				static const int slots = SLOTS;
+
+				guard() : record(local_record()) {}
+				guard(const guard&) = delete;
+				guard& operator=(const guard&) = delete;
+				~guard() {
+					for(auto& h : record->hazard) {
+						h.store(nullptr, std::memory_order_release);
+					}
+				}
+
+				template<typename N>
+				N* protect(int slot, const std::atomic<N*>& src) {
+					N* p = src.load(std::memory_order_acquire);
+					while(true) {
+						record->hazard[slot].store(reclamation_detail::strip_tag(p), std::memory_order_seq_cst);
+						N* again = src.load(std::memory_order_acquire);
+						if(again == p) {
+							return p;
+						}
+						p = again;
+					}
+				}
+		};
+		static const bool needs_validation = true;
+
+		template<typename N>
+		static void retire(N* p) {
+			retire(p, &reclamation_detail::delete_node<N>);
+		}
+
+		static void retire(void* p, void (*deleter)(void*)) {
+			thread_record* record = local_record();
+			record->retired.push_back({p, deleter, 0});
+			if(record->retired.size() >= RECLAIM_THRESHOLD) {
+				scan(record);
+			}
+		}
+};
+
+#endif // lacpp_reclamation_hpp
@@ -0,0 +1,221 @@
+#ifndef lacpp_segmented_sieve_hpp
+#define lacpp_segmented_sieve_hpp lacpp_segmented_sieve_hpp
+
+/* cache-blocked, bit-packed sieve of Eratosthenes for the sieve programs
+ *
+ * Only odd numbers are stored, one bit each in 64-bit words. [0, max] is
+ * cut into windows of SIEVE_WINDOW_BYTES, about the size of an L1 data
+ * cache, so marking the multiples of all base primes in a window does not
+ * leave the cache. Window w holds the odd numbers of
+ * [w * SIEVE_WINDOW_SPAN, (w + 1) * SIEVE_WINDOW_SPAN), bit k stands for
+ * w * SIEVE_WINDOW_SPAN + 2k + 1.
+ *
+ * The odd primes up to sqrt(max) are found first with a small sequential
+ * sieve. After that every window can be sieved on its own: a thread that
+ * is handed a whole window is the only one to write its words, and memory
+ * is O(sqrt(max)) plus the windows in flight instead of O(max).
+ *
+ * Ownership is word-granular: a window is a whole number of 64-bit words
+ * in a buffer of its own, and marking is a plain read-modify-write of
+ * those words. Threads must never share a window while it is sieved, and
+ * whoever reads it afterwards has to synchronize with the thread that
+ * sieved it (join, the barrier of run_rounds(), or a mutex as in
+ * taskQueue_sieve.cpp).
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <pthread.h>
+#include <vector>
+
+static const std::uint64_t SIEVE_WINDOW_BYTES = 32 * 1024;
+static const std::uint64_t SIEVE_WINDOW_BITS = 8 * SIEVE_WINDOW_BYTES;
+/* numbers covered by one window, odd and even */
+static const std::uint64_t SIEVE_WINDOW_SPAN = 2 * SIEVE_WINDOW_BITS;
+
+static_assert(SIEVE_WINDOW_BITS % 64 == 0, "windows must not share a word");
+
+/* windows are handed out in rounds of this many per thread */
+static const unsigned int SIEVE_WINDOWS_PER_THREAD = 4;
+
+/* largest r with r * r <= n */
+static inline std::uint64_t sieve_isqrt(std::uint64_t n) {
+	std::uint64_t r = static_cast<std::uint64_t>(std::sqrt(static_cast<double>(n)));
+	/* the double may be off by one either way */
+	while(r * r > n) {
+		r--;
+	}
+	while((r + 1) * (r + 1) <= n) {
+		r++;
+	}
+	return r;
+}
+
+/* number of windows that cover [0, max] */
+static inline std::uint64_t sieve_windows(std::uint64_t max) {
+	return max / SIEVE_WINDOW_SPAN + 1;
+}
+
+/* the odd primes up to sqrt(max), ascending */
+static inline std::vector<std::uint32_t> sieve_base_primes(std::uint64_t max) {
+	std::uint64_t root = sieve_isqrt(max);
+	std::vector<char> composite(root + 1, 0);
+	std::vector<std::uint32_t> primes;
+	for(std::uint64_t i = 3; i <= root; i += 2) {
+		if(!composite[i]) {
+			primes.push_back(static_cast<std::uint32_t>(i));
+			for(std::uint64_t j = i * i; j <= root; j += 2 * i) {
+				composite[j] = 1;
+			}
+		}
+	}
+	return primes;
+}
+
+/* one window of the sieve, reused for window after window */
+class sieve_window {
+	/* set bits are composite */
+	std::vector<std::uint64_t> words;
+	std::uint64_t lo;
+	/* valid bits, fewer than SIEVE_WINDOW_BITS in the last window */
+	std::uint64_t bits;
+
+	/* the valid bits of words[i] that are primes */
+	std::uint64_t primes_in(std::uint64_t i) const {
+		std::uint64_t p = ~words[i];
+		if(bits < 64 * (i + 1)) {
+			p &= (std::uint64_t(1) << (bits - 64 * i)) - 1;
+		}
+		return p;
+	}
+
+	public:
+		sieve_window() : words(SIEVE_WINDOW_BITS / 64), lo(0), bits(0) {}
+
+		/* sieve window w of [0, max] with primes = sieve_base_primes(max) */
+		void sieve(std::uint64_t w, std::uint64_t max, const std::vector<std::uint32_t>& primes) {
+			lo = w * SIEVE_WINDOW_SPAN;
+			std::uint64_t hi = std::min(lo + SIEVE_WINDOW_SPAN, max + 1);
+			bits = hi > lo ? (hi - lo) / 2 : 0;
+			std::fill(words.begin(), words.end(), 0);
+			if(lo == 0) {
+				/* 1 */
+				words[0] = 1;
+			}
+			for(std::uint32_t p : primes) {
+				std::uint64_t square = std::uint64_t(p) * p;
+				if(square >= hi) {
+					break;
+				}
+				/* first odd multiple of p in the window that is not p */
+				std::uint64_t first = std::max(square, (lo + p - 1) / p * p);
+				if(first % 2 == 0) {
+					first += p;
+				}
+				for(std::uint64_t k = (first - lo) / 2; k < bits; k += p) {
+					words[k / 64] |= std::uint64_t(1) << (k % 64);
+				}
+			}
+		}
+
+		/* call f for every prime in the window in ascending order,
+		 * including 2 in the first window
+		 */
+		template<typename F>
+		void for_each_prime(F f) const {
+			if(lo == 0 && bits > 0) {
+				f(std::uint64_t(2));
+			}
+			for(std::uint64_t i = 0; 64 * i < bits; i++) {
+				for(std::uint64_t p = primes_in(i); p != 0; p &= p - 1) {
+					f(lo + 2 * (64 * i + __builtin_ctzll(p)) + 1);
+				}
+			}
+		}
+
+		/* number of primes in the window, including 2 in the first one */
+		std::uint64_t count() const {
+			std::uint64_t cnt = lo == 0 && bits > 0 ? 1 : 0;
+			for(std::uint64_t i = 0; 64 * i < bits; i++) {
+				cnt += __builtin_popcountll(primes_in(i));
+			}
+			return cnt;
+		}
+};
+
+namespace sieve_detail {
+	/* state shared by run_rounds() and its threads */
+	template<typename Assign>
+	struct rounds {
+		unsigned int threads;
+		unsigned int perRound;
+		std::uint64_t max;
+		std::uint64_t windowCount;
+		std::vector<std::uint32_t> primes;
+		/* two halves of perRound windows, used by alternate rounds */
+		std::vector<sieve_window> windows;
+		pthread_barrier_t barrier;
+		Assign assign;
+
+		rounds(unsigned int threads, std::uint64_t max, Assign assign)
+			: threads(threads), perRound(threads * SIEVE_WINDOWS_PER_THREAD), max(max),
+			windowCount(sieve_windows(max)), primes(sieve_base_primes(max)),
+			windows(2 * perRound), assign(assign) {}
+	};
+
+	template<typename Assign>
+	struct worker {
+		rounds<Assign>* r;
+		unsigned int id;
+		pthread_t thread;
+	};
+
+	/* sieve the windows assigned to w.id, one round per barrier */
+	template<typename Assign>
+	void* sieve_rounds(void* arg) {
+		worker<Assign>& w = *static_cast<worker<Assign>*>(arg);
+		rounds<Assign>& r = *w.r;
+		for(std::uint64_t round = 0; round * r.perRound < r.windowCount; round++) {
+			for(unsigned int i = 0; i < r.perRound; i++) {
+				std::uint64_t window = round * r.perRound + i;
+				if(window < r.windowCount && r.assign(i, r.threads) == w.id) {
+					r.windows[(round % 2) * r.perRound + i].sieve(window, r.max, r.primes);
+				}
+			}
+			pthread_barrier_wait(&r.barrier);
+		}
+		return nullptr;
+	}
+}
+
+/* sieve [0, max] with threads threads and call f for every prime in
+ * ascending order, from the calling thread
+ * Window i of a round, 0 <= i < threads * SIEVE_WINDOWS_PER_THREAD, is
+ * sieved by thread assign(i, threads). While f reads one round, the
+ * threads sieve the next one into the other half of the windows; a barrier
+ * after every round hands the windows over.
+ */
+template<typename Assign, typename F>
+void run_rounds(unsigned int threads, std::uint64_t max, Assign assign, F f) {
+	sieve_detail::rounds<Assign> r(threads, max, assign);
+	std::vector<sieve_detail::worker<Assign>> workers(threads);
+	pthread_barrier_init(&r.barrier, nullptr, threads + 1);
+	for(unsigned int id = 0; id < threads; id++) {
+		workers[id].r = &r;
+		workers[id].id = id;
+		pthread_create(&workers[id].thread, nullptr, sieve_detail::sieve_rounds<Assign>, &workers[id]);
+	}
+	for(std::uint64_t round = 0; round * r.perRound < r.windowCount; round++) {
+		pthread_barrier_wait(&r.barrier);
+		for(unsigned int i = 0; i < r.perRound && round * r.perRound + i < r.windowCount; i++) {
+			r.windows[(round % 2) * r.perRound + i].for_each_prime(f);
+		}
+	}
+	for(auto& w : workers) {
+		pthread_join(w.thread, nullptr);
+	}
+	pthread_barrier_destroy(&r.barrier);
+}
+
+#endif // lacpp_segmented_sieve_hpp
@@ -0,0 +1,190 @@
+#ifndef lacpp_sequential_list_hpp
+#define lacpp_sequential_list_hpp lacpp_sequential_list_hpp
+
+/* a sorted list implementation by David Klaftenegger, 2015
+ * please report bugs or suggest improvements to david.klaftenegger@it.uu.se
+ *
+ * The non-concurrent list lives in namespace sequential, so that wrappers
+ * such as flat_combining.hpp and delegation.hpp can use it and still
+ * define a sorted_list of their own. sorted_list.hpp makes it the global
+ * sorted_list for the plain benchmark.
+ */
+
+#include <cstddef>
+
+#include "node_pool.hpp"
+
+namespace sequential {
+	/* struct for list nodes */
+	template<typename T>
+	struct node {
+		T value;
+		node<T>* next;
+	};
+
+	/* non-concurrent sorted singly-linked list */
+	template<typename T, typename Alloc = default_allocator>
+	class sorted_list {
+		node<T>* first = nullptr;
+
+		public:
+			/* default implementations:
+			 * default constructor
+			 * copy constructor (note: shallow copy)
+			 * move constructor
+			 * copy assignment operator (note: shallow copy)
+			 * move assignment operator
+			 *
+			 * The first is required due to the others,
+			 * which are explicitly listed due to the rule of five.
+			 */
+			sorted_list() = default;
+			sorted_list(const sorted_list<T, Alloc>& other) = default;
+			sorted_list(sorted_list<T, Alloc>&& other) = default;
+			sorted_list<T, Alloc>& operator=(const sorted_list<T, Alloc>& other) = default;
+			sorted_list<T, Alloc>& operator=(sorted_list<T, Alloc>&& other) = default;
+			~sorted_list() {
+				while(first != nullptr) {
+					remove(first->value);
+				}
+			}
+			/* insert v into the list */
+			void insert(T v) {
+				/* first find position */
+				node<T>* pred = nullptr;
+				node<T>* succ = first;
+				while(succ != nullptr && succ->value < v) {
+					pred = succ;
+					succ = succ->next;
+				}
+			
+				/* construct new node */
+				node<T>* current = Alloc::template create<node<T>>();
+				current->value = v;
+
+				/* insert new node between pred and succ */
+				current->next = succ;
+				if(pred == nullptr) {
+					first = current;
+				} else {
+					pred->next = current;
+				}
+			}
+
+			void remove(T v) {
+				/* first find position */
+				node<T>* pred = nullptr;
+				node<T>* current = first;
+				while(current != nullptr && current->value < v) {
+					pred = current;
+					current = current->next;
+				}
+				if(current == nullptr || current->value != v) {
+					/* v not found */
+					return;
+				}
+				/* remove current */
+				if(pred == nullptr) {
+					first = current->next;
+				} else {
+					pred->next = current->next;
+				}
+				Alloc::template destroy<node<T>>(current);
+			}
+
+			/* count elements with value v in the list */
+			std::size_t count(T v) {
+				std::size_t cnt = 0;
+				/* first go to value v */
+				node<T>* current = first;
+				while(current != nullptr && current->value < v) {
+					current = current->next;
+				}
+				/* count elements */
+				while(current != nullptr && current->value == v) {
+					cnt++;
+					current = current->next;
+				}
+				return cnt;
+			}
+
+			/* insert the n values in keys, sorted ascending, in one pass */
+			void insert_batch(const T* keys, std::size_t n) {
+				node<T>* pred = nullptr;
+				node<T>* succ = first;
+				for(std::size_t i = 0; i < n; i++) {
+					/* find position, continuing from the previous key */
+					while(succ != nullptr && succ->value < keys[i]) {
+						pred = succ;
+						succ = succ->next;
+					}
+
+					/* construct new node */
+					node<T>* current = Alloc::template create<node<T>>();
+					current->value = keys[i];
+
+					/* insert new node between pred and succ */
+					current->next = succ;
+					if(pred == nullptr) {
+						first = current;
+					} else {
+						pred->next = current;
+					}
+					pred = current;
+				}
+			}
+
+			/* remove the n values in keys, sorted ascending, in one pass */
+			void remove_batch(const T* keys, std::size_t n) {
+				node<T>* pred = nullptr;
+				node<T>* current = first;
+				for(std::size_t i = 0; i < n; i++) {
+					/* find position, continuing from the previous key */
+					while(current != nullptr && current->value < keys[i]) {
+						pred = current;
+						current = current->next;
+					}
+					if(current == nullptr || current->value != keys[i]) {
+						/* keys[i] not found */
+						continue;
+					}
+					/* remove current */
+					node<T>* next = current->next;
+					if(pred == nullptr) {
+						first = next;
+					} else {
+						pred->next = next;
+					}
+					Alloc::template destroy<node<T>>(current);
+					current = next;
+				}
+			}
+
+			/* count elements for the n values in keys, sorted ascending,
+			 * in one pass; counts[i] is the count of keys[i]
+			 */
+			void count_batch(const T* keys, std::size_t n, std::size_t* counts) {
+				node<T>* current = first;
+				for(std::size_t i = 0; i < n; i++) {
+					if(i > 0 && keys[i] == keys[i - 1]) {
+						/* the run of keys[i] is already behind us */
+						counts[i] = counts[i - 1];
+						continue;
+					}
+					/* go to value keys[i] */
+					while(current != nullptr && current->value < keys[i]) {
+						current = current->next;
+					}
+					/* count elements */
+					std::size_t cnt = 0;
+					while(current != nullptr && current->value == keys[i]) {
+						cnt++;
+						current = current->next;
+					}
+					counts[i] = cnt;
+				}
+			}
+	};
+}
+
+#endif // lacpp_sequential_list_hpp
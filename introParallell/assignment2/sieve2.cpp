@@ -1,39 +1,16 @@
 #include <iostream>
-#include <cmath>
+#include <cstdint>
 #include <cstring>
-#include <pthread.h>
 #include <chrono>
-#include <vector>
-#include <algorithm>
 
-//Threadbased and constant interval partition of numbers 
-using uint = unsigned int;
-
-std::vector<bool> marked;
-std::vector<uint> primes;
-
-pthread_mutex_t primesMutex(PTHREAD_MUTEX_INITIALIZER);
-
-void* sieve(void *args) {
-    uint *range(reinterpret_cast<uint*>(args));
-
-    uint start(range[0]);
-    uint jump(range[1]);
-    uint max(range[2]);
+#include "segmented_sieve.hpp"
 
-    for (uint i(start); i <= max; i += jump) {
-        if (!marked.at(i)) {
-            pthread_mutex_lock(&primesMutex);
-            primes.push_back(i);
-            pthread_mutex_unlock(&primesMutex);
-
-            for (uint j(i * i); j <= max; j += i) {
-                marked[j] = true;
-            }
-        }
-    }
+//Threadbased and constant interval partition of windows
+using uint = unsigned int;
 
-    return nullptr;
+// thread id takes every threads-th window of a round
+uint owner(uint window, uint threads) {
+    return window % threads;
 }
 
 void usage(char *program, int code = 0) {
@@ -60,9 +37,9 @@ int main(int argc, char *argv[]) {
         usage(argv[0], 1);
     }
 
-    uint max;
+    std::uint64_t max;
     try {
-        max = std::stoi(argv[2]);
+        max = std::stoull(argv[2]);
     } catch (const std::exception& e) {
         usage(argv[0], 1);
     } if (max < 2) {
@@ -72,39 +49,12 @@ int main(int argc, char *argv[]) {
     // *** timing begins here ***
     auto start_time(std::chrono::system_clock::now());
 
-    marked.resize(max + 1, false);
-    marked[0] = true;
-    marked[1] = true;
-
-    uint sqrtMax(static_cast<uint>(sqrt(max)));
-    pthread_t pThreads[threads];
-    int thread_args[threads][3];
-
-    thread_args[0][0] = 2;
-    thread_args[0][1] = sqrtMax;
-    thread_args[0][2] = max;
-
-    sieve(thread_args[0]);
-
-    for (uint i(0); i < threads; ++i) {
-        thread_args[i][0] = 3 + i;
-        thread_args[i][1] = threads;
-        thread_args[i][2] = max;
-
-        pthread_create(&pThreads[i], nullptr, sieve, thread_args[i]);
-    }
-
-    for (uint i(0); i < threads; ++i) {
-        pthread_join(pThreads[i], nullptr);
-    }
-
-    std::sort(primes.begin(), primes.end());
-    for (int prime : primes) {
+    run_rounds(threads, max, owner, [](std::uint64_t prime) {
         std::cout << prime << " ";
-    }
+    });
 
     // *** timing ends here ***
     std::chrono::duration<double> duration((std::chrono::system_clock::now() - start_time));
     std::cout << "Finished in " << duration.count() << " seconds (wall clock)." << std::endl;
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,172 @@
+#ifndef lacpp_striped_hash_mutexlock_hpp
+#define lacpp_striped_hash_mutexlock_hpp lacpp_striped_hash_mutexlock_hpp
+
+/* a lock-striped hash multiset with the interface of the sorted lists,
+ * after the striped hash set of Herlihy & Shavit
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+#include "locks.hpp"
+#include "node_pool.hpp"
+
+/* struct for bucket nodes */
+template<typename T>
+struct node {
+	T value;
+	node<T>* next;
+};
+
+/* concurrent hash multiset using lock striping
+ * insert, remove and count touch one bucket, so they take expected
+ * constant time instead of walking a list; the elements are not sorted
+ *
+ * There are STRIPES locks, and bucket b is guarded by lock
+ * b % STRIPES. The number of buckets is STRIPES times a power of two, so
+ * a value keeps its lock when the table grows and a thread can pick the
+ * lock before it looks at the table. When a stripe holds more than
+ * MAX_LOAD elements per bucket on average the table doubles, with all
+ * locks held in order.
+ */
+template<typename T, typename Lock = default_lock<std::mutex>, typename Alloc = default_allocator>
+class sorted_list {
+	static const std::size_t STRIPES = 64;
+	static const std::size_t MAX_LOAD = 4;
+
+	/* a lock and the number of elements in its buckets */
+	struct alignas(64) stripe {
+		Lock lock;
+		std::size_t count = 0;
+	};
+
+	stripe stripes[STRIPES];
+	/* only accessed with a stripe lock held, changed with all of them */
+	node<T>** buckets;
+	std::size_t capacity;
+
+	/* std::hash is the identity for integers, mix the bits so that
+	 * the low ones used for the bucket depend on all of them
+	 */
+	static std::size_t hash(const T& v) {
+		std::uint64_t h = std::hash<T>()(v);
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		return static_cast<std::size_t>(h);
+	}
+
+	/* double the table unless someone else already did */
+	void resize(std::size_t old_capacity) {
+		for(auto& s : stripes) {
+			s.lock.lock();
+		}
+		if(capacity == old_capacity) {
+			std::size_t new_capacity = 2 * capacity;
+			node<T>** new_buckets = new node<T>*[new_capacity]();
+			for(std::size_t b = 0; b < capacity; b++) {
+				node<T>* current = buckets[b];
+				while(current != nullptr) {
+					node<T>* next = current->next;
+					node<T>*& bucket = new_buckets[hash(current->value) & (new_capacity - 1)];
+					current->next = bucket;
+					bucket = current;
+					current = next;
+				}
+			}
+			delete[] buckets;
+			buckets = new_buckets;
+			capacity = new_capacity;
+		}
+		for(auto& s : stripes) {
+			s.lock.unlock();
+		}
+	}
+
+	public:
+		/* default constructor only:
+		 * copying or moving a list would race with concurrent users
+		 */
+		sorted_list() : buckets(new node<T>*[STRIPES]()), capacity(STRIPES) {}
+		sorted_list(const sorted_list<T, Lock, Alloc>& other) = delete;
+		sorted_list(sorted_list<T, Lock, Alloc>&& other) = delete;
+		sorted_list<T, Lock, Alloc>& operator=(const sorted_list<T, Lock, Alloc>& other) = delete;
+		sorted_list<T, Lock, Alloc>& operator=(sorted_list<T, Lock, Alloc>&& other) = delete;
+		~sorted_list() {
+			for(std::size_t b = 0; b < capacity; b++) {
+				while(buckets[b] != nullptr) {
+					node<T>* next = buckets[b]->next;
+					Alloc::template destroy<node<T>>(buckets[b]);
+					buckets[b] = next;
+				}
+			}
+			delete[] buckets;
+		}
+
+		/* insert v into the set */
+		void insert(T v) {
+			std::size_t h = hash(v);
+			stripe& s = stripes[h % STRIPES];
+			s.lock.lock();
+
+			/* construct new node at the front of its bucket */
+			node<T>*& bucket = buckets[h & (capacity - 1)];
+			node<T>* current = Alloc::template create<node<T>>();
+			current->value = v;
+			current->next = bucket;
+			bucket = current;
+
+			bool full = ++s.count > MAX_LOAD * (capacity / STRIPES);
+			std::size_t seen = capacity;
+			s.lock.unlock();
+			if(full) {
+				resize(seen);
+			}
+		}
+
+		void remove(T v) {
+			std::size_t h = hash(v);
+			stripe& s = stripes[h % STRIPES];
+			s.lock.lock();
+
+			/* find v in its bucket */
+			node<T>* pred = nullptr;
+			node<T>* current = buckets[h & (capacity - 1)];
+			while(current != nullptr && current->value != v) {
+				pred = current;
+				current = current->next;
+			}
+			if(current == nullptr) {
+				/* v not found */
+				s.lock.unlock();
+				return;
+			}
+
+			/* remove current */
+			if(pred == nullptr) {
+				buckets[h & (capacity - 1)] = current->next;
+			} else {
+				pred->next = current->next;
+			}
+			s.count--;
+			s.lock.unlock();
+			Alloc::template destroy<node<T>>(current);
+		}
+
+		/* count elements with value v in the set */
+		std::size_t count(T v) {
+			std::size_t h = hash(v);
+			stripe& s = stripes[h % STRIPES];
+			std::size_t cnt = 0;
+			s.lock.lock();
+			for(node<T>* current = buckets[h & (capacity - 1)]; current != nullptr; current = current->next) {
+				cnt += current->value == v ? 1 : 0;
+			}
+			s.lock.unlock();
+			return cnt;
+		}
+};
+
+#endif // lacpp_striped_hash_mutexlock_hpp
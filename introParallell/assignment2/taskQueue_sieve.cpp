@@ -1,5 +1,5 @@
 #include <iostream>
-#include <cmath>
+#include <cstdint>
 #include <cstring>
 #include <pthread.h>
 #include <chrono>
@@ -7,19 +7,47 @@
 #include <queue>
 #include <functional>
 
+#include "segmented_sieve.hpp"
+
 using uint = unsigned int;
 
+// Every task sieves one window of segmented_sieve.hpp. The main thread
+// enqueues a round of tasks ahead and prints the finished round meanwhile.
+
 std::queue<std::function<void()>> taskQueue;
-std::vector<bool> marked;
+std::vector<std::uint32_t> basePrimes;
+std::vector<sieve_window> windows;
+uint windowsDone[2];
 
 pthread_mutex_t taskQueueMutex(PTHREAD_MUTEX_INITIALIZER);
 pthread_cond_t taskQueueCond(PTHREAD_COND_INITIALIZER);
+pthread_cond_t windowsDoneCond(PTHREAD_COND_INITIALIZER);
 bool allTasksCompleted(false);
 
-void markMultiples(uint i, uint max) {
-    for (uint j(2*i); j <= max; j += i) {
-        marked[j] = true;
+void sieveWindow(std::uint64_t w, uint slot, uint half, std::uint64_t max) {
+    windows[slot].sieve(w, max, basePrimes);
+
+    pthread_mutex_lock(&taskQueueMutex);
+    ++windowsDone[half];
+    pthread_cond_signal(&windowsDoneCond); // Notify the main thread
+    pthread_mutex_unlock(&taskQueueMutex);
+}
+
+// Enqueue the windows of a round, returns their number
+uint enqueueRound(std::uint64_t round, uint perRound, std::uint64_t windowCount, std::uint64_t max) {
+    uint half(round % 2);
+    uint tasks(0);
+    pthread_mutex_lock(&taskQueueMutex);
+    for (uint i(0); i < perRound && round * perRound + i < windowCount; ++i, ++tasks) {
+        std::uint64_t w(round * perRound + i);
+        uint slot(half * perRound + i);
+        taskQueue.push([w, slot, half, max]() {
+            sieveWindow(w, slot, half, max);
+        });
     }
+    pthread_cond_broadcast(&taskQueueCond); // Notify waiting threads to pick up the tasks
+    pthread_mutex_unlock(&taskQueueMutex);
+    return tasks;
 }
 
 void* worker(void* arg) {
@@ -65,16 +93,16 @@ int main(int argc, char* argv[]) {
     uint threads;
     try {
         threads = std::stoi(argv[1]);
-    } catch (std::exception) {
+    } catch (const std::exception& e) {
         usage(argv[0], 1);
     } if (threads < 1) {
         usage(argv[0], 1);
     }
 
-    uint max;
+    std::uint64_t max;
     try {
-        max = std::stoi(argv[2]);
-    } catch (std::exception) {
+        max = std::stoull(argv[2]);
+    } catch (const std::exception& e) {
         usage(argv[0], 1);
     } if (max < 2) {
         usage(argv[0], 1);
@@ -83,11 +111,11 @@ int main(int argc, char* argv[]) {
     // *** timing begins here ***
     auto start_time(std::chrono::system_clock::now());
 
-    marked.resize(max + 1, false);
-    marked[0] = true;
-    marked[1] = true;
+    basePrimes = sieve_base_primes(max);
+    std::uint64_t windowCount(sieve_windows(max));
+    uint perRound(threads * SIEVE_WINDOWS_PER_THREAD);
+    windows.resize(2 * perRound);
 
-    uint sqrtMax(static_cast<uint>(sqrt(max)));
     pthread_t pThreads[threads];
 
     // Create worker threads
@@ -95,16 +123,27 @@ int main(int argc, char* argv[]) {
         pthread_create(&pThreads[i], nullptr, worker, nullptr);
     }
 
-    // Generate and enqueue tasks
-    for (uint i(2); i <= sqrtMax; ++i) {
-        if (!marked.at(i)) {
-            std::function<void()> task([i, max]() {
-                markMultiples(i, max);
+    // Generate tasks a round ahead and print the primes of finished rounds
+    uint tasks[2];
+    tasks[0] = enqueueRound(0, perRound, windowCount, max);
+    for (std::uint64_t round(0); round * perRound < windowCount; ++round) {
+        uint half(round % 2);
+        if ((round + 1) * perRound < windowCount) {
+            tasks[1 - half] = enqueueRound(round + 1, perRound, windowCount, max);
+        }
+
+        pthread_mutex_lock(&taskQueueMutex);
+        while (windowsDone[half] < tasks[half]) {
+            pthread_cond_wait(&windowsDoneCond, &taskQueueMutex);
+        }
+        windowsDone[half] = 0;
+        pthread_mutex_unlock(&taskQueueMutex);
+
+        // Print prime numbers
+        for (uint i(0); i < tasks[half]; ++i) {
+            windows[half * perRound + i].for_each_prime([](std::uint64_t prime) {
+                std::cout << prime << " ";
             });
-            pthread_mutex_lock(&taskQueueMutex);
-            taskQueue.push(task);
-            pthread_cond_signal(&taskQueueCond); // Notify a waiting thread to pick up the task
-            pthread_mutex_unlock(&taskQueueMutex);
         }
     }
 
@@ -118,15 +157,8 @@ int main(int argc, char* argv[]) {
         pthread_join(pThreads[i], nullptr);
     }
 
-    // Print prime numbers
-    for (uint i(2); i <= max; ++i) {
-        if (!marked.at(i)) {
-            std::cout << i << " ";
-        }
-    }
-
     // *** timing ends here ***
     std::chrono::duration<double> duration((std::chrono::system_clock::now() - start_time));
     std::cout << "Finished in " << duration.count() << " seconds (wall clock)." << std::endl;
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,137 @@
+#ifndef lacpp_thread_ids_hpp
+#define lacpp_thread_ids_hpp lacpp_thread_ids_hpp
+
+/* small dense ids for the threads using a list
+ *
+ * Wrappers that keep one slot per thread (flat_combining.hpp,
+ * delegation.hpp) index their slot arrays with these ids. An id is taken
+ * on the first call of current_thread_id() in a thread and returned when
+ * the thread exits, so the benchmark's short-lived worker threads reuse
+ * the low ids.
+ *
+ * The number of ids is fixed at first use from the number of cpus, with
+ * room for the oversubscribed runs of benchmark.sh (4x the cpus) and the
+ * threads that prefill and tear down a list.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+namespace thread_ids_detail {
+	/* at least this many threads at a time, and more on machines
+	 * with over MIN_THREADS / THREADS_PER_CPU cpus
+	 */
+	static const int MIN_THREADS = 256;
+	static const int THREADS_PER_CPU = 8;
+
+	class registry {
+		const int capacity;
+		std::atomic<bool>* used;
+		/* highest id ever handed out + 1 */
+		std::atomic<int> bound;
+
+		registry() : capacity(std::max(MIN_THREADS, THREADS_PER_CPU * static_cast<int>(std::thread::hardware_concurrency()))),
+			used(new std::atomic<bool>[capacity]), bound(0) {
+			for(int i = 0; i < capacity; i++) {
+				used[i].store(false, std::memory_order_relaxed);
+			}
+		}
+
+		public:
+			/* never destroyed: threads may exit after static destruction */
+			static registry& instance() {
+				static registry* r = new registry();
+				return *r;
+			}
+
+			int acquire() {
+				for(int i = 0; i < capacity; i++) {
+					if(!used[i].load(std::memory_order_relaxed) && !used[i].exchange(true, std::memory_order_acquire)) {
+						int b = bound.load(std::memory_order_relaxed);
+						while(b < i + 1 && !bound.compare_exchange_weak(b, i + 1, std::memory_order_release, std::memory_order_relaxed)) {
+						}
+						return i;
+					}
+				}
+				throw std::runtime_error("thread ids: too many threads");
+			}
+
+			void release(int id) {
+				used[id].store(false, std::memory_order_release);
+			}
+
+			int limit() {
+				return bound.load(std::memory_order_acquire);
+			}
+
+			int size() const {
+				return capacity;
+			}
+	};
+
+	/* the id of the calling thread, held until it exits */
+	struct holder {
+		int id;
+		holder() : id(registry::instance().acquire()) {}
+		~holder() {
+			registry::instance().release(id);
+		}
+	};
+}
+
+/* number of ids, fixed at first use */
+static inline int max_thread_ids() {
+	return thread_ids_detail::registry::instance().size();
+}
+
+/* id of the calling thread, in [0, max_thread_ids()) */
+static inline int current_thread_id() {
+	thread_local thread_ids_detail::holder h;
+	return h.id;
+}
+
+/* all ids handed out so far are below this bound */
+static inline int thread_id_limit() {
+	return thread_ids_detail::registry::instance().limit();
+}
+
+/* one S for every thread id, each on its own cache lines if S is
+ * aligned to them (new ignores that alignment before C++17)
+ */
+template<typename S>
+class thread_slots {
+	S* slots;
+
+	public:
+		thread_slots() {
+			void* p = nullptr;
+			if(posix_memalign(&p, std::max(alignof(S), sizeof(void*)), max_thread_ids() * sizeof(S)) != 0) {
+				throw std::bad_alloc();
+			}
+			slots = static_cast<S*>(p);
+			for(int i = 0; i < max_thread_ids(); i++) {
+				new(&slots[i]) S();
+			}
+		}
+
+		thread_slots(const thread_slots<S>&) = delete;
+		thread_slots<S>& operator=(const thread_slots<S>&) = delete;
+
+		~thread_slots() {
+			for(int i = 0; i < max_thread_ids(); i++) {
+				slots[i].~S();
+			}
+			std::free(slots);
+		}
+
+		S& operator[](int id) {
+			return slots[id];
+		}
+};
+
+#endif // lacpp_thread_ids_hpp
@@ -0,0 +1,215 @@
+#ifndef lacpp_unrolled_list_mutexlock_hpp
+#define lacpp_unrolled_list_mutexlock_hpp lacpp_unrolled_list_mutexlock_hpp
+
+/* an unrolled sorted list based on the sorted list implementation
+ * by David Klaftenegger, 2015
+ */
+
+#include <cstddef>
+#include <mutex>
+
+#include "locks.hpp"
+#include "node_pool.hpp"
+
+/* struct for list nodes
+ * keys[0..count) is sorted, and no key is larger than a key of the next node
+ * nodes in the list are never empty
+ */
+template<typename T, std::size_t K, typename Lock>
+struct node {
+	T keys[K];
+	std::size_t count;
+	Lock lock;
+	node<T, K, Lock>* next;
+};
+
+/* concurrent unrolled sorted list using hand-over-hand locking
+ * every node holds up to K elements, so a traversal touches about n/K
+ * nodes and K sets the granularity of the locking
+ * head is a sentinel without elements whose lock guards the first link
+ */
+template<typename T, std::size_t K = 16, typename Lock = default_lock<std::mutex>, typename Alloc = default_allocator>
+class sorted_list {
+	static_assert(K >= 2, "full nodes are split in two");
+	typedef node<T, K, Lock> node_t;
+
+	node_t head;
+
+	/* lock hand-over-hand up to the first node whose largest element
+	 * is not smaller than v, current is nullptr if there is none
+	 * returns with pred and current (if any) locked
+	 */
+	void find(T v, node_t*& pred, node_t*& current) {
+		head.lock.lock();
+		pred = &head;
+		current = head.next;
+		(current != nullptr) ? current->lock.lock() : void();
+		while (current != nullptr && current->keys[current->count - 1] < v) {
+			pred->lock.unlock();
+			pred = current;
+			current = current->next;
+			(current != nullptr) ? current->lock.lock() : void();
+		}
+	}
+
+	/* insert v into the sorted keys of n, which must have space */
+	static void insert_into(node_t* n, T v) {
+		std::size_t i = n->count;
+		while (i > 0 && v < n->keys[i - 1]) {
+			n->keys[i] = n->keys[i - 1];
+			i--;
+		}
+		n->keys[i] = v;
+		n->count++;
+	}
+
+	public:
+		/* default implementations:
+		 * default constructor
+		 * copy constructor (note: shallow copy)
+		 * move constructor
+		 * copy assignment operator (note: shallow copy)
+		 * move assignment operator
+		 *
+		 * The first is required due to the others,
+		 * which are explicitly listed due to the rule of five.
+		 */
+		sorted_list() : head() {
+			head.count = 0;
+			head.next = nullptr;
+		}
+		sorted_list(const sorted_list<T, K, Lock, Alloc>& other) = default;
+		sorted_list(sorted_list<T, K, Lock, Alloc>&& other) = default;
+		sorted_list<T, K, Lock, Alloc>& operator=(const sorted_list<T, K, Lock, Alloc>& other) = default;
+		sorted_list<T, K, Lock, Alloc>& operator=(sorted_list<T, K, Lock, Alloc>&& other) = default;
+		~sorted_list() {
+			node_t* current = head.next;
+			while (current != nullptr) {
+				node_t* next = current->next;
+				Alloc::template destroy<node_t>(current);
+				current = next;
+			}
+		}
+
+		/* insert v into the list */
+		void insert(T v) {
+			node_t *pred;
+			node_t *current;
+
+			/* first find position */
+			find(v, pred, current);
+
+			if (current == nullptr) {
+				/* v is larger than all elements: append to the last node */
+				if (pred != &head && pred->count < K) {
+					pred->keys[pred->count++] = v;
+				} else {
+					node_t *newNode(Alloc::template create<node_t>());
+					newNode->keys[0] = v;
+					newNode->count = 1;
+					newNode->next = nullptr;
+					pred->next = newNode;
+				}
+				pred->lock.unlock();
+				return;
+			}
+
+			/* only current changes from here on */
+			pred->lock.unlock();
+			node_t* target = current;
+			if (current->count == K) {
+				/* split: the upper half moves to a new node after current */
+				node_t *newNode(Alloc::template create<node_t>());
+				std::size_t half = K / 2;
+				for (std::size_t i = half; i < K; i++) {
+					newNode->keys[i - half] = current->keys[i];
+				}
+				newNode->count = K - half;
+				current->count = half;
+				newNode->next = current->next;
+				current->next = newNode;
+				if (current->keys[half - 1] < v) {
+					target = newNode;
+				}
+			}
+			insert_into(target, v);
+			current->lock.unlock();
+		}
+
+		void remove(T v) {
+			node_t *pred;
+			node_t *current;
+
+			/* first find position */
+			find(v, pred, current);
+			if (current == nullptr) {
+				/* v not found */
+				pred->lock.unlock();
+				return;
+			}
+
+			/* the first element not smaller than v is in current */
+			std::size_t i = 0;
+			while (current->keys[i] < v) {
+				i++;
+			}
+			if (current->keys[i] != v) {
+				/* v not found */
+				current->lock.unlock();
+				pred->lock.unlock();
+				return;
+			}
+
+			/* remove v from current */
+			for (; i + 1 < current->count; i++) {
+				current->keys[i] = current->keys[i + 1];
+			}
+			current->count--;
+			if (current->count > 0) {
+				current->lock.unlock();
+				pred->lock.unlock();
+				return;
+			}
+
+			/* remove the empty node
+			 * any thread that could reach current would need pred's lock first,
+			 * so it is safe to free current once it is unlinked
+			 */
+			pred->next = current->next;
+			pred->lock.unlock();
+			current->lock.unlock();
+			Alloc::template destroy<node_t>(current);
+		}
+
+		/* count elements with value v in the list */
+		std::size_t count(T v) {
+			std::size_t cnt = 0;
+			node_t *pred;
+			node_t *current;
+
+			/* first go to value v */
+			find(v, pred, current);
+			pred->lock.unlock();
+
+			/* count elements, the run of v may continue in later nodes */
+			while (current != nullptr) {
+				for (std::size_t i = 0; i < current->count && !(v < current->keys[i]); i++) {
+					if (current->keys[i] == v) {
+						cnt++;
+					}
+				}
+				if (v < current->keys[current->count - 1]) {
+					break;
+				}
+				node_t* next = current->next;
+				(next != nullptr) ? next->lock.lock() : void();
+				current->lock.unlock();
+				current = next;
+			}
+
+			(current != nullptr) ? current->lock.unlock() : void();
+			return cnt;
+		}
+};
+
+#endif // lacpp_unrolled_list_mutexlock_hpp
@@ -1,41 +1,91 @@
 #include <iostream>
 #include <cstring>
+#include <cstdint>
 #include <vector>
 #include <cmath>
+#include <algorithm>
 #include <omp.h>
 
-void sequentialSieve(std::vector<bool> &isPrime, int max) {
-    int sqrtMax = static_cast<int>(std::sqrt(max));
-    for (int i = 2; i <= sqrtMax; ++i) {
-        if (isPrime[i]) {
-            for (int j = i * i; j <= max; j += i) {
-                isPrime[j] = false;
+// Segmented sieve: only odd numbers are stored, one bit each, in windows
+// about the size of the L1 data cache. Window w holds the odd numbers of
+// [w * WINDOW_SPAN, (w + 1) * WINDOW_SPAN), bit k stands for
+// w * WINDOW_SPAN + 2k + 1. Whole windows are handed to the threads, so no
+// two threads write the same word, and memory is O(sqrt(max)) for the seed
+// primes plus one window per thread.
+const std::uint64_t WINDOW_BITS = 8 * 32 * 1024;
+const std::uint64_t WINDOW_SPAN = 2 * WINDOW_BITS;
+
+std::vector<std::uint32_t> sequentialSieve(std::uint64_t max) {
+    std::uint64_t sqrtMax = static_cast<std::uint64_t>(std::sqrt(static_cast<double>(max)));
+    while (sqrtMax * sqrtMax > max) {
+        --sqrtMax;
+    }
+    while ((sqrtMax + 1) * (sqrtMax + 1) <= max) {
+        ++sqrtMax;
+    }
+    std::vector<char> composite(sqrtMax + 1, 0);
+    std::vector<std::uint32_t> seedPrimes; // the odd primes up to sqrt(max)
+    for (std::uint64_t i = 3; i <= sqrtMax; i += 2) {
+        if (!composite[i]) {
+            seedPrimes.push_back(static_cast<std::uint32_t>(i));
+            for (std::uint64_t j = i * i; j <= sqrtMax; j += 2 * i) {
+                composite[j] = 1;
             }
         }
     }
+    return seedPrimes;
+}
+
+// marks the odd composites of window w and returns the number of primes in it
+std::uint64_t sieveWindow(std::vector<std::uint64_t> &window, std::uint64_t w, std::uint64_t max, const std::vector<std::uint32_t> &seedPrimes) {
+    std::uint64_t lo = w * WINDOW_SPAN;
+    std::uint64_t hi = std::min(lo + WINDOW_SPAN, max + 1);
+    std::uint64_t bits = (hi - lo) / 2;
+    std::fill(window.begin(), window.end(), 0);
+    if (lo == 0) {
+        window[0] = 1; // 1 is not prime
+    }
+
+    for (std::uint32_t p : seedPrimes) {
+        std::uint64_t square = std::uint64_t(p) * p;
+        if (square >= hi) {
+            break;
+        }
+        std::uint64_t startMultiple = std::max(square, (lo + p - 1) / p * p); // first multiple to mark in this window
+        if (startMultiple % 2 == 0) {
+            startMultiple += p;
+        }
+        for (std::uint64_t k = (startMultiple - lo) / 2; k < bits; k += p) {
+            window[k / 64] |= std::uint64_t(1) << (k % 64); //marking the odd multiples as non prime in this window
+        }
+    }
+
+    std::uint64_t count = lo == 0 ? 1 : 0; // 2
+    for (std::uint64_t i = 0; 64 * i < bits; ++i) {
+        std::uint64_t primes = ~window[i];
+        if (bits < 64 * (i + 1)) {
+            primes &= (std::uint64_t(1) << (bits - 64 * i)) - 1;
+        }
+        count += __builtin_popcountll(primes);
+    }
+    return count;
 }
 
-void parallelSieve(std::vector<bool> &isPrime, int max, int numThreads) {
-    int sqrtMax = static_cast<int>(std::sqrt(max));
-    int chunkSize = (max - sqrtMax) / numThreads;
-    
-    #pragma omp parallel num_threads(numThreads)
+std::uint64_t parallelSieve(std::uint64_t max, int numThreads) {
+    std::vector<std::uint32_t> seedPrimes = sequentialSieve(max);
+    std::uint64_t windows = max / WINDOW_SPAN + 1;
+    std::uint64_t count = 0;
+
+    #pragma omp parallel num_threads(numThreads) reduction(+:count)
     {
-        int threadId = omp_get_thread_num();
-        int start = sqrtMax + 1 + threadId * chunkSize; //start if a threads chunk 
-        int end = (threadId == numThreads - 1) ? max : start + chunkSize - 1; //end of a threads chunk
-        
-        for (int i = 2; i <= sqrtMax; ++i) { //this is because we use sequentially calculated primes as seed 
-            if (isPrime[i]) {
-                int startMultiple = std::max(i * i, (start / i) * i); // Calculate the first multiple to mark
-                for (int j = startMultiple; j <= end; j += i) {
-                    isPrime[j] = false; //marking the multiples as non prime in this chunk
-                }
-            }
-            //// Barrier synchronization to ensure all threads have processed the current 'i' before moving to the next 'i
-            #pragma omp barrier
+        std::vector<std::uint64_t> window(WINDOW_BITS / 64); // every thread sieves in its own window
+
+        #pragma omp for schedule(dynamic)
+        for (std::uint64_t w = 0; w < windows; ++w) {
+            count += sieveWindow(window, w, max, seedPrimes);
         }
     }
+    return count;
 }
 
 void usage(char* program, int code = 0) {
@@ -63,42 +113,24 @@ int main(int argc, char* argv[]) {
         usage(argv[0], 1);
     }
 
-    int Max;
+    std::uint64_t Max;
     try {
-        Max = std::stoi(argv[2]);
+        Max = std::stoull(argv[2]);
     } catch (const std::exception& e) {
         usage(argv[0], 1);
     } if (Max < 2) {
         usage(argv[0], 1);
     }
 
-    
-    // Create a vector to store whether each number is prime or not
-    std::vector<bool> isPrime(Max + 1, true);
-    
-    // Mark 0 and 1 as non-prime
-    isPrime[0] = isPrime[1] = false;
-    
     double startTime = omp_get_wtime();
-    
-    // Sequentially compute primes up to sqrt(Max)
-    sequentialSieve(isPrime, static_cast<int>(std::sqrt(Max)));
-    
-    // Parallelize the Sieve of Eratosthenes for the remaining range
-
-    parallelSieve(isPrime, Max, numThreads);
-    
+
+    // Sequentially compute the seed primes up to sqrt(Max), then sieve
+    // the windows of the whole range in parallel
+    std::uint64_t count = parallelSieve(Max, numThreads);
+
     double endTime = omp_get_wtime();
-    
-    
-    // // Print the prime numbers
-    // for (int i = 2; i <= Max; ++i) {
-    //     if (isPrime[i]) {
-    //         std::cout << i << " ";
-    //     }
-    // }
-
-    std::cout << "Prime numbers up to " << Max << " computed in " << endTime - startTime << " seconds." << std::endl;
+
+    std::cout << "Prime numbers up to " << Max << " computed in " << endTime - startTime << " seconds (" << count << " primes)." << std::endl;
 
     return 0;
 }